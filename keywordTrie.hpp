@@ -25,13 +25,48 @@
 
 #ifndef MISCCO_KEYWORDTRIE_HPP
 #define MISCCO_KEYWORDTRIE_HPP
-#include <cctype>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <future>
 #include <memory>
+#include <mutex>
 #include <queue>
 #include <set>
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
 #include <vector>
+#if __cplusplus >= 202002L
+#include <span>
+#endif
+#if defined(__unix__) || defined(__APPLE__)
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE4_2__)
+#include <nmmintrin.h>
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#endif
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
 
 namespace miscco
 {
@@ -57,258 +92,3494 @@ class keyword_trie
             : keyword(key), id(id)
         {
         }
-        explicit Result(const Result &res, const std::size_t endPos)
-            : keyword(res.keyword), id(res.id), start(endPos - res.keyword.size() + 1), end(endPos)
+        explicit Result(const std::string_view key, const std::size_t id, const std::size_t endPos,
+                        const std::size_t length)
+            : keyword(key), id(id), start(endPos - length + 1), end(endPos)
         {
         }
     };
 
+    /**
+     * @brief The Match struct containing the information about matches during a
+     * search without copying the keyword. The keyword view points into the
+     * storage of the trie and stays valid until the trie is modified.
+     */
+    struct Match
+    {
+        std::size_t id;           /**< The index of the keyword in the keyword list*/
+        std::size_t start;        /**< The starting position of the match */
+        std::size_t end;          /**< The end position of the match */
+        std::string_view keyword; /**< View of the found keyword as it was added */
+    };
+
+    /**
+     * @brief The Layout enum selecting the frozen representation of the trie.
+     */
+    enum class Layout
+    {
+        Sparse,     /**< Children are stored as ranges of a shared edge array */
+        Dense,      /**< Complete transition table with one entry per state and byte class */
+        DoubleArray /**< Children are placed at base + character, verified by check */
+    };
+
+    /**
+     * @brief The Engine enum selecting how complete texts are searched.
+     */
+    enum class Engine
+    {
+        Automaton, /**< Walk the keyword trie */
+        Teddy      /**< Packed SIMD fingerprint search, for up to 64 keywords */
+    };
+
+    /**
+     * @brief The MatchKind enum selecting which matches are reported for
+     * complete texts.
+     */
+    enum class MatchKind
+    {
+        All,            /**< Every match, including overlapping ones */
+        LeftmostFirst,  /**< Non-overlapping, the earliest added keyword at the leftmost start */
+        LeftmostLongest /**< Non-overlapping, the longest keyword at the leftmost start */
+    };
+
   private:
+    /**
+     * @brief The LabelSet struct storing the labels of the outgoing edges of a
+     * Node as a 256 bit presence bitmap. With the edges sorted by label, the
+     * number of present labels below a character is the index of its edge.
+     */
+    struct LabelSet
+    {
+        std::array<std::uint64_t, 4> bits{};  /**< Presence bit of every character */
+        std::array<std::uint8_t, 4> before{}; /**< Number of labels in the preceding words */
+        std::uint32_t reserved = 0;           /**< Always 0, so images hold no padding */
+
+        bool contains(const char character) const
+        {
+            const unsigned char c = static_cast<unsigned char>(character);
+            return (bits[c >> 6] >> (c & 63)) & 1;
+        }
+
+        std::size_t rank(const char character) const
+        {
+            const unsigned char c = static_cast<unsigned char>(character);
+            return before[c >> 6] + popCount(bits[c >> 6] & ((std::uint64_t{1} << (c & 63)) - 1));
+        }
+
+        void insert(const char character)
+        {
+            const unsigned char c = static_cast<unsigned char>(character);
+            bits[c >> 6] |= std::uint64_t{1} << (c & 63);
+            for (std::size_t word = (c >> 6) + 1; word < before.size(); word++)
+            {
+                before[word]++;
+            }
+        }
+    };
+
     /**
      * @brief The Node struct containing the information of a trie Node.
      */
     struct Node
     {
-        int id = -1;                  /**< Keyword index */
-        const int depth = 0;          /**< Depth in the trie*/
-        const char c = '\0';          /**< Character labelling the incoming edge */
-        Node *parent;                 /**< Parent Node */
-        Node *failure;                /**< Failure link */
-        Node *output;                 /**< Output link */
-        std::vector<Node *> children; /**< Child Nodes */
+        int id = -1;                   /**< Keyword index */
+        const std::uint32_t index = 0; /**< Position in trieNodes and frozen state */
+        const int depth = 0;           /**< Depth in the trie*/
+        const char c = '\0';           /**< Character labelling the incoming edge */
+        Node *parent;                  /**< Parent Node */
+        Node *failure;                 /**< Failure link */
+        Node *output;                  /**< Output link */
+        std::vector<Node *> children;  /**< Child Nodes, sorted by label */
+        LabelSet labels;               /**< Labels of the child Nodes */
+        std::vector<Node *> fallbacks; /**< Nodes whose failure link is this Node */
+        std::uint32_t failSlot = UINT32_MAX; /**< Position in the fallbacks of the failure link */
+
+        explicit Node() = default;
+        explicit Node(const std::uint32_t idx, const int d, const char character, Node *par,
+                      Node *root)
+            : index(idx), depth(d), c(character), parent(par), failure(root), output(root)
+        {
+        }
+    };
+
+    /**
+     * @brief The Teddy struct containing the fingerprint tables of the Teddy
+     * engine. Every keyword is assigned to one of 8 buckets. For each of the
+     * first characters of the keywords, the tables map the low and the high
+     * nibble of a character to the buckets containing a keyword with that
+     * nibble at that position. A position of the text is a candidate for all
+     * buckets that remain after combining the tables of all its fingerprint
+     * characters.
+     */
+    struct Teddy
+    {
+        static constexpr std::size_t maxKeywords = 64; /**< Largest supported keyword set */
+        static constexpr std::size_t maxWidth = 3;     /**< Longest fingerprint */
+
+        std::size_t width = 0; /**< Number of fingerprint characters, 0 if not built */
+        std::array<std::array<std::uint8_t, 16>, maxWidth> low{};  /**< Buckets by low nibble */
+        std::array<std::array<std::uint8_t, 16>, maxWidth> high{}; /**< Buckets by high nibble */
+        std::array<std::vector<std::uint32_t>, 8> buckets;         /**< Keyword indices per bucket */
+        std::vector<std::string> patterns; /**< Case folded keywords by keyword index */
+    };
+
+    /**
+     * @brief The State struct containing the information of a frozen trie state.
+     * States are addressed by the index of the Node they were frozen from, so
+     * the root is always state 0.
+     */
+    struct State
+    {
+        std::int32_t id = -1;        /**< Keyword index */
+        std::uint32_t depth = 0;     /**< Depth in the trie */
+        std::uint32_t failure = 0;   /**< Failure link */
+        std::uint32_t output = 0;    /**< Output link */
+        std::uint32_t firstEdge = 0; /**< Index of the first outgoing edge */
+        std::uint32_t edgeCount = 0; /**< Number of outgoing edges */
+        std::uint32_t labels = 0;    /**< Index into edgeSets if edgeCount > maxScannedEdges */
+    };
+
+    /** States with up to this many edges scan their labels instead of a LabelSet */
+    static constexpr std::uint32_t maxScannedEdges = 4;
+
+    /**
+     * @brief The Slot struct containing one entry of the double array. The
+     * child of the state in slot s for character c is in slot base + c if the
+     * check of that slot is s. Slots are not state indices, so every slot also
+     * links to its frozen state for the keyword index and output links.
+     */
+    struct Slot
+    {
+        std::uint32_t base = 0;          /**< Offset of the children of this slot */
+        std::uint32_t check = UINT32_MAX; /**< Slot of the parent, UINT32_MAX if free */
+        std::uint32_t failure = 0;       /**< Slot of the failure link */
+        std::uint32_t state = 0;         /**< Index of the frozen state */
+    };
+
+    /**
+     * @brief The Table struct viewing a frozen array, which lives either in a
+     * vector of the trie or in a loaded image.
+     */
+    template <typename T>
+    struct Table
+    {
+        const T *data = nullptr; /**< The first element */
+        std::size_t size = 0;    /**< The number of elements */
+
+        const T &operator[](const std::size_t index) const { return data[index]; }
+    };
+
+    /**
+     * @brief The Frozen struct containing the views of all arrays searched by
+     * the frozen automaton.
+     */
+    struct Frozen
+    {
+        Table<State> states;                 /**< Frozen states, empty unless frozen */
+        Table<char> edgeLabels;              /**< Frozen edge labels */
+        Table<std::uint32_t> edgeTargets;    /**< Frozen edge targets */
+        Table<LabelSet> edgeSets;            /**< Frozen labels of states with many edges */
+        Table<std::uint32_t> transitions;    /**< Dense transition table */
+        Table<Slot> slots;                   /**< Double array */
+        Table<std::uint64_t> keywordOffsets; /**< Start of every keyword in keywordChars, images only */
+        Table<char> keywordChars;            /**< The characters of all keywords, images only */
+    };
+
+    /**
+     * @brief The ImageHeader struct at the start of a binary image of a frozen
+     * trie. The arrays of the frozen trie follow as sections, which are
+     * addressed by their offset from the start of the image, so an image can
+     * be mapped at any address.
+     */
+    struct ImageHeader
+    {
+        /** Sections of an image, in the order of the Frozen tables */
+        enum Section
+        {
+            States,
+            EdgeLabels,
+            EdgeTargets,
+            EdgeSets,
+            Transitions,
+            Slots,
+            KeywordOffsets,
+            KeywordChars,
+            SectionCount
+        };
+
+        static constexpr std::array<char, 8> signature{'K', 'W', 'T', 'R', 'I', 'E', '\0', '\0'};
+        static constexpr std::uint32_t currentVersion = 1;
+        static constexpr std::uint32_t nativeOrder = 0x01020304;
+
+        std::array<char, 8> magic = signature;               /**< Identifies an image */
+        std::uint32_t version = currentVersion;              /**< Version of the format */
+        std::uint32_t byteOrder = nativeOrder;               /**< Detects a foreign byte order */
+        std::uint32_t caseSensitive = CaseSensitive;         /**< The template argument of the trie */
+        std::uint32_t layout = 0;                            /**< The layout of the frozen trie */
+        std::uint32_t classCount = 0;                        /**< Number of byte classes */
+        std::uint32_t reserved = 0;                          /**< Always 0 */
+        std::uint64_t maxLength = 0;                         /**< Length of the longest keyword */
+        std::uint64_t size = 0;                              /**< Size of the image in bytes */
+        std::array<std::uint8_t, 256> byteClasses{};         /**< Byte class of every character */
+        std::array<std::uint8_t, 256> startSet{};            /**< Characters that can start a keyword */
+        std::array<std::uint64_t, SectionCount> offsets{};   /**< Offset of every section */
+        std::array<std::uint64_t, SectionCount> counts{};    /**< Number of elements of every section */
+    };
+
+    /**
+     * @brief The FoldRange struct describing code points with a common simple
+     * case folding. Every stride-th code point from first to last folds to the
+     * code point delta above it.
+     */
+    struct FoldRange
+    {
+        char32_t first;     /**< First code point of the range */
+        char32_t last;      /**< Last code point of the range */
+        std::int32_t delta; /**< Distance to the folded code point */
+        char32_t stride;    /**< Distance between the code points of the range */
+    };
+
+    /** Lower case of every character, as std::tolower in the "C" locale */
+    static constexpr std::array<char, 256> foldTable = [] {
+        std::array<char, 256> table{};
+        for (std::size_t character = 0; character < table.size(); character++)
+        {
+            table[character] = static_cast<char>(
+                character >= 'A' && character <= 'Z' ? character - 'A' + 'a' : character);
+        }
+        return table;
+    }();
+
+    /** Simple case folding beyond ASCII, the entries with status C and S of
+     * CaseFolding.txt of Unicode 14.0. The Turkic mappings are left out.
+     */
+    static constexpr FoldRange foldRanges[] = {
+        {0x00B5, 0x00B5, 775, 1},    {0x00C0, 0x00D6, 32, 1},     {0x00D8, 0x00DE, 32, 1},
+        {0x0100, 0x012E, 1, 2},      {0x0132, 0x0136, 1, 2},      {0x0139, 0x0147, 1, 2},
+        {0x014A, 0x0176, 1, 2},      {0x0178, 0x0178, -121, 1},   {0x0179, 0x017D, 1, 2},
+        {0x017F, 0x017F, -268, 1},   {0x0181, 0x0181, 210, 1},    {0x0182, 0x0184, 1, 2},
+        {0x0186, 0x0186, 206, 1},    {0x0187, 0x0187, 1, 1},      {0x0189, 0x018A, 205, 1},
+        {0x018B, 0x018B, 1, 1},      {0x018E, 0x018E, 79, 1},     {0x018F, 0x018F, 202, 1},
+        {0x0190, 0x0190, 203, 1},    {0x0191, 0x0191, 1, 1},      {0x0193, 0x0193, 205, 1},
+        {0x0194, 0x0194, 207, 1},    {0x0196, 0x0196, 211, 1},    {0x0197, 0x0197, 209, 1},
+        {0x0198, 0x0198, 1, 1},      {0x019C, 0x019C, 211, 1},    {0x019D, 0x019D, 213, 1},
+        {0x019F, 0x019F, 214, 1},    {0x01A0, 0x01A4, 1, 2},      {0x01A6, 0x01A6, 218, 1},
+        {0x01A7, 0x01A7, 1, 1},      {0x01A9, 0x01A9, 218, 1},    {0x01AC, 0x01AC, 1, 1},
+        {0x01AE, 0x01AE, 218, 1},    {0x01AF, 0x01AF, 1, 1},      {0x01B1, 0x01B2, 217, 1},
+        {0x01B3, 0x01B5, 1, 2},      {0x01B7, 0x01B7, 219, 1},    {0x01B8, 0x01B8, 1, 1},
+        {0x01BC, 0x01BC, 1, 1},      {0x01C4, 0x01C4, 2, 1},      {0x01C5, 0x01C5, 1, 1},
+        {0x01C7, 0x01C7, 2, 1},      {0x01C8, 0x01C8, 1, 1},      {0x01CA, 0x01CA, 2, 1},
+        {0x01CB, 0x01DB, 1, 2},      {0x01DE, 0x01EE, 1, 2},      {0x01F1, 0x01F1, 2, 1},
+        {0x01F2, 0x01F4, 1, 2},      {0x01F6, 0x01F6, -97, 1},    {0x01F7, 0x01F7, -56, 1},
+        {0x01F8, 0x021E, 1, 2},      {0x0220, 0x0220, -130, 1},   {0x0222, 0x0232, 1, 2},
+        {0x023A, 0x023A, 10795, 1},  {0x023B, 0x023B, 1, 1},      {0x023D, 0x023D, -163, 1},
+        {0x023E, 0x023E, 10792, 1},  {0x0241, 0x0241, 1, 1},      {0x0243, 0x0243, -195, 1},
+        {0x0244, 0x0244, 69, 1},     {0x0245, 0x0245, 71, 1},     {0x0246, 0x024E, 1, 2},
+        {0x0345, 0x0345, 116, 1},    {0x0370, 0x0372, 1, 2},      {0x0376, 0x0376, 1, 1},
+        {0x037F, 0x037F, 116, 1},    {0x0386, 0x0386, 38, 1},     {0x0388, 0x038A, 37, 1},
+        {0x038C, 0x038C, 64, 1},     {0x038E, 0x038F, 63, 1},     {0x0391, 0x03A1, 32, 1},
+        {0x03A3, 0x03AB, 32, 1},     {0x03C2, 0x03C2, 1, 1},      {0x03CF, 0x03CF, 8, 1},
+        {0x03D0, 0x03D0, -30, 1},    {0x03D1, 0x03D1, -25, 1},    {0x03D5, 0x03D5, -15, 1},
+        {0x03D6, 0x03D6, -22, 1},    {0x03D8, 0x03EE, 1, 2},      {0x03F0, 0x03F0, -54, 1},
+        {0x03F1, 0x03F1, -48, 1},    {0x03F4, 0x03F4, -60, 1},    {0x03F5, 0x03F5, -64, 1},
+        {0x03F7, 0x03F7, 1, 1},      {0x03F9, 0x03F9, -7, 1},     {0x03FA, 0x03FA, 1, 1},
+        {0x03FD, 0x03FF, -130, 1},   {0x0400, 0x040F, 80, 1},     {0x0410, 0x042F, 32, 1},
+        {0x0460, 0x0480, 1, 2},      {0x048A, 0x04BE, 1, 2},      {0x04C0, 0x04C0, 15, 1},
+        {0x04C1, 0x04CD, 1, 2},      {0x04D0, 0x052E, 1, 2},      {0x0531, 0x0556, 48, 1},
+        {0x10A0, 0x10C5, 7264, 1},   {0x10C7, 0x10C7, 7264, 1},   {0x10CD, 0x10CD, 7264, 1},
+        {0x13F8, 0x13FD, -8, 1},     {0x1C80, 0x1C80, -6222, 1},  {0x1C81, 0x1C81, -6221, 1},
+        {0x1C82, 0x1C82, -6212, 1},  {0x1C83, 0x1C84, -6210, 1},  {0x1C85, 0x1C85, -6211, 1},
+        {0x1C86, 0x1C86, -6204, 1},  {0x1C87, 0x1C87, -6180, 1},  {0x1C88, 0x1C88, 35267, 1},
+        {0x1C90, 0x1CBA, -3008, 1},  {0x1CBD, 0x1CBF, -3008, 1},  {0x1E00, 0x1E94, 1, 2},
+        {0x1E9B, 0x1E9B, -58, 1},    {0x1E9E, 0x1E9E, -7615, 1},  {0x1EA0, 0x1EFE, 1, 2},
+        {0x1F08, 0x1F0F, -8, 1},     {0x1F18, 0x1F1D, -8, 1},     {0x1F28, 0x1F2F, -8, 1},
+        {0x1F38, 0x1F3F, -8, 1},     {0x1F48, 0x1F4D, -8, 1},     {0x1F59, 0x1F5F, -8, 2},
+        {0x1F68, 0x1F6F, -8, 1},     {0x1F88, 0x1F8F, -8, 1},     {0x1F98, 0x1F9F, -8, 1},
+        {0x1FA8, 0x1FAF, -8, 1},     {0x1FB8, 0x1FB9, -8, 1},     {0x1FBA, 0x1FBB, -74, 1},
+        {0x1FBC, 0x1FBC, -9, 1},     {0x1FBE, 0x1FBE, -7173, 1},  {0x1FC8, 0x1FCB, -86, 1},
+        {0x1FCC, 0x1FCC, -9, 1},     {0x1FD8, 0x1FD9, -8, 1},     {0x1FDA, 0x1FDB, -100, 1},
+        {0x1FE8, 0x1FE9, -8, 1},     {0x1FEA, 0x1FEB, -112, 1},   {0x1FEC, 0x1FEC, -7, 1},
+        {0x1FF8, 0x1FF9, -128, 1},   {0x1FFA, 0x1FFB, -126, 1},   {0x1FFC, 0x1FFC, -9, 1},
+        {0x2126, 0x2126, -7517, 1},  {0x212A, 0x212A, -8383, 1},  {0x212B, 0x212B, -8262, 1},
+        {0x2132, 0x2132, 28, 1},     {0x2160, 0x216F, 16, 1},     {0x2183, 0x2183, 1, 1},
+        {0x24B6, 0x24CF, 26, 1},     {0x2C00, 0x2C2F, 48, 1},     {0x2C60, 0x2C60, 1, 1},
+        {0x2C62, 0x2C62, -10743, 1}, {0x2C63, 0x2C63, -3814, 1},  {0x2C64, 0x2C64, -10727, 1},
+        {0x2C67, 0x2C6B, 1, 2},      {0x2C6D, 0x2C6D, -10780, 1}, {0x2C6E, 0x2C6E, -10749, 1},
+        {0x2C6F, 0x2C6F, -10783, 1}, {0x2C70, 0x2C70, -10782, 1}, {0x2C72, 0x2C72, 1, 1},
+        {0x2C75, 0x2C75, 1, 1},      {0x2C7E, 0x2C7F, -10815, 1}, {0x2C80, 0x2CE2, 1, 2},
+        {0x2CEB, 0x2CED, 1, 2},      {0x2CF2, 0x2CF2, 1, 1},      {0xA640, 0xA66C, 1, 2},
+        {0xA680, 0xA69A, 1, 2},      {0xA722, 0xA72E, 1, 2},      {0xA732, 0xA76E, 1, 2},
+        {0xA779, 0xA77B, 1, 2},      {0xA77D, 0xA77D, -35332, 1}, {0xA77E, 0xA786, 1, 2},
+        {0xA78B, 0xA78B, 1, 1},      {0xA78D, 0xA78D, -42280, 1}, {0xA790, 0xA792, 1, 2},
+        {0xA796, 0xA7A8, 1, 2},      {0xA7AA, 0xA7AA, -42308, 1}, {0xA7AB, 0xA7AB, -42319, 1},
+        {0xA7AC, 0xA7AC, -42315, 1}, {0xA7AD, 0xA7AD, -42305, 1}, {0xA7AE, 0xA7AE, -42308, 1},
+        {0xA7B0, 0xA7B0, -42258, 1}, {0xA7B1, 0xA7B1, -42282, 1}, {0xA7B2, 0xA7B2, -42261, 1},
+        {0xA7B3, 0xA7B3, 928, 1},    {0xA7B4, 0xA7C2, 1, 2},      {0xA7C4, 0xA7C4, -48, 1},
+        {0xA7C5, 0xA7C5, -42307, 1}, {0xA7C6, 0xA7C6, -35384, 1}, {0xA7C7, 0xA7C9, 1, 2},
+        {0xA7D0, 0xA7D0, 1, 1},      {0xA7D6, 0xA7D8, 1, 2},      {0xA7F5, 0xA7F5, 1, 1},
+        {0xAB70, 0xABBF, -38864, 1}, {0xFF21, 0xFF3A, 32, 1},     {0x10400, 0x10427, 40, 1},
+        {0x104B0, 0x104D3, 40, 1},   {0x10570, 0x1057A, 39, 1},   {0x1057C, 0x1058A, 39, 1},
+        {0x1058C, 0x10592, 39, 1},   {0x10594, 0x10595, 39, 1},   {0x10C80, 0x10CB2, 64, 1},
+        {0x118A0, 0x118BF, 32, 1},   {0x16E40, 0x16E5F, 32, 1},   {0x1E900, 0x1E921, 34, 1}};
+
+    /** Keywords with more case variants than this are only folded like ASCII */
+    static constexpr std::size_t maxVariants = 1 << 12;
+
+    /** ASCII keywords with more variants of "ss" than this are not expanded */
+    static constexpr std::size_t maxSharpVariants = 32;
+
+    Node *root;                                   /**< The root Node */
+    std::deque<Node> trieNodes;                   /**< Container of the Nodes */
+    std::vector<Result> keywords;                 /**< Container of the Result stubs */
+    std::size_t maxLength = 0;                    /**< Length of the longest keyword */
+    bool linksPending = false;                    /**< Keywords were added without failure links */
+    std::vector<bool> removed;                    /**< Removed keywords by index */
+    std::size_t removedCount = 0;                 /**< Number of removed keywords */
+    std::size_t tombstones = 0;                   /**< Removed keywords whose Nodes remain */
+    double compactionThreshold = 0.25;            /**< Share of tombstones that triggers compact */
+    std::array<bool, 256> startSet{};             /**< Characters that can start a keyword */
+    std::vector<char> startBytes;                 /**< The characters contained in startSet */
+
+    std::vector<State> states;                   /**< Frozen states, empty unless frozen */
+    std::vector<char> edgeLabels;                /**< Frozen edge labels, sorted per state */
+    std::vector<std::uint32_t> edgeTargets;      /**< Frozen edge targets */
+    std::vector<LabelSet> edgeSets;              /**< Frozen labels of states with many edges */
+    std::vector<std::uint32_t> transitions;      /**< Dense transition table, one row per state */
+    std::array<std::uint8_t, 256> byteClasses{}; /**< Byte equivalence class of every character */
+    std::uint32_t classCount = 0;                /**< Number of byte classes, the width of a row */
+    std::vector<Slot> slots;                     /**< Double array, root in slot 0 */
+    Layout layout = Layout::Sparse;              /**< The layout of the frozen trie */
+    Engine engine = Engine::Automaton;           /**< The engine used for complete texts */
+    MatchKind matchKind = MatchKind::All;        /**< The matches reported for complete texts */
+    Teddy teddy;                                 /**< Tables of the Teddy engine */
+    Frozen frozen;                               /**< Views searched by the frozen automaton */
+    std::shared_ptr<const void> image;           /**< Keeps a loaded image alive */
+  public:
+    /**
+     * @brief trie Initializes the trie structure with its root Node.
+     */
+    keyword_trie() { addRoot(); }
+
+    keyword_trie(const keyword_trie &) = delete;
+    keyword_trie &operator=(const keyword_trie &) = delete;
+    keyword_trie(keyword_trie &&) = default;
+    keyword_trie &operator=(keyword_trie &&) = default;
+
+    /**
+     * @brief addString Insert a new keyword into the keyword trie.
+     * @param key The new keyword to be inserted.
+     * @param addFailure Flag to signal whether the failure links should
+     * immediately be updated.
+     */
+    void addString(const std::string &key, const bool addFailure = true)
+    {
+        if (key.empty())
+        {
+            return;
+        }
+        thaw();
+        const std::size_t firstNew = trieNodes.size();
+        const std::vector<Node *> terminals = addKeyword(key, keywords.size());
+        keywords.emplace_back(key, keywords.size());
+
+        if (!addFailure)
+        {
+            linksPending = true;
+            addStartBytes();
+        }
+        else if (linksPending)
+        {
+            addFailureLinks();
+        }
+        else
+        {
+            updateFailureLinks(terminals, firstNew);
+        }
+    }
+
+    /**
+     * @brief addString Wrapper around addString(std::string, bool) to add a
+     * set of strings.
+     * @param keyList The set containing the keys.
+     * @param threads The number of threads computing the failure links.
+     */
+    void addString(const std::set<std::string> &keyList, const unsigned threads = 1)
+    {
+        addStrings(keyList, false, threads);
+    }
+
+    /**
+     * @brief addString Wrapper around addString(std::string, bool) to add a
+     * vector of strings.
+     * @param keyList The vector containing the keys.
+     * @param threads The number of threads computing the failure links.
+     */
+    void addString(const std::vector<std::string> &keyList, const unsigned threads = 1)
+    {
+        addStrings(keyList, false, threads);
+    }
+
+    /**
+     * @brief addSortedString Adds a vector of strings that is already sorted,
+     * skipping the sort of addString(std::vector<std::string>).
+     * @param keyList The vector containing the keys, sorted by their case
+     * folded characters compared as unsigned char.
+     * @param threads The number of threads computing the failure links.
+     */
+    void addSortedString(const std::vector<std::string> &keyList, const unsigned threads = 1)
+    {
+        addStrings(keyList, true, threads);
+    }
+
+    /**
+     * @brief finalize Computes the failure links of all keywords added with
+     * addString(key, false). The trie is processed one depth at a time and the
+     * Nodes of every depth are shared among several threads.
+     * @param threads The number of threads to use.
+     */
+    void finalize(const unsigned threads = std::thread::hardware_concurrency())
+    {
+        if (linksPending)
+        {
+            addFailureLinks(threads);
+        }
+    }
+
+    /**
+     * @brief removeString Removes a keyword from the trie. Its Nodes are only
+     * unmarked and the output links that reported it are fixed immediately.
+     * The Nodes themselves are reclaimed by compact, which runs automatically
+     * once the removed keywords exceed the compaction threshold. The indices
+     * of the other keywords never change.
+     * @param key The keyword to be removed, compared after case folding.
+     * @return Returns true if the keyword was found.
+     */
+    bool removeString(const std::string &key)
+    {
+        thaw();
+        const std::vector<Node *> found = findKeyword(key);
+        if (found.empty() || isRemoved(static_cast<std::size_t>(found.front()->id)))
+        {
+            return false;
+        }
+        /* The argument may spell only one variant, so the stored keyword is used */
+        const std::size_t id = static_cast<std::size_t>(found.front()->id);
+        const std::vector<Node *> terminals = findKeyword(keywords[id].keyword);
+        for (Node *terminal : terminals)
+        {
+            terminal->id = -1;
+        }
+        for (Node *terminal : terminals)
+        {
+            updateOutputLinks(terminal);
+        }
+        removed.resize(keywords.size(), false);
+        removed[id] = true;
+        removedCount++;
+        tombstones++;
+        const std::size_t inTrie = keywords.size() - removedCount + tombstones;
+        if (static_cast<double>(tombstones) > compactionThreshold * static_cast<double>(inTrie))
+        {
+            compact();
+        }
+        return true;
+    }
+
+    /**
+     * @brief compact Rebuilds the trie from the remaining keywords, which
+     * reclaims the Nodes of removed keywords and renumbers the states. The
+     * keywords keep their indices.
+     */
+    void compact()
+    {
+        thaw();
+        trieNodes.clear();
+        addRoot();
+        maxLength = 0;
+        for (std::size_t id = 0; id < keywords.size(); id++)
+        {
+            if (!isRemoved(id))
+            {
+                addKeyword(keywords[id].keyword, id);
+            }
+        }
+        tombstones = 0;
+        addFailureLinks();
+    }
+
+    /**
+     * @brief setCompactionThreshold Sets the share of removed keywords among
+     * the keywords still occupying the trie above which removeString calls
+     * compact.
+     * @param ratio The threshold, 1 or above disables automatic compaction.
+     */
+    void setCompactionThreshold(const double ratio) { compactionThreshold = ratio; }
+
+    /**
+     * @brief freeze Copies the finished trie into a flat representation. All
+     * states live in one contiguous array addressed by 32 bit indices and the
+     * children of every state are stored as a range of one shared edge array.
+     * Subsequent searches run on the frozen states until the next keyword is
+     * added.
+     * @param mode Layout::Dense additionally precomputes the complete transition
+     * function, so that every input character costs exactly one table lookup
+     * at the price of one entry per state and byte class. Layout::DoubleArray
+     * replaces the edge arrays with a double array, which finds every child
+     * with a single lookup while staying about as compact as the edges.
+     */
+    void freeze(const Layout mode = Layout::Sparse)
+    {
+        if (trieNodes.size() > UINT32_MAX)
+        {
+            throw std::length_error("The keyword trie has too many nodes to be frozen.");
+        }
+        thaw();
+        states.resize(trieNodes.size());
+        for (const Node &current : trieNodes)
+        {
+            const Node *node = &current;
+            State &state = states[node->index];
+            state.id = node->id;
+            state.depth = node->depth;
+            state.failure = node->failure->index;
+            state.output = node->output->index;
+            state.firstEdge = edgeLabels.size();
+            state.edgeCount = node->children.size();
+            if (state.edgeCount > maxScannedEdges)
+            {
+                state.labels = edgeSets.size();
+                edgeSets.push_back(node->labels);
+            }
+            for (const Node *child : node->children)
+            {
+                edgeLabels.push_back(child->c);
+                edgeTargets.push_back(child->index);
+            }
+        }
+
+        addStartBytes();
+        layout = mode;
+        if (layout == Layout::Dense)
+        {
+            addTransitions();
+        }
+        else if (layout == Layout::DoubleArray)
+        {
+            addSlots();
+        }
+        frozen = Frozen{{states.data(), states.size()},
+                        {edgeLabels.data(), edgeLabels.size()},
+                        {edgeTargets.data(), edgeTargets.size()},
+                        {edgeSets.data(), edgeSets.size()},
+                        {transitions.data(), transitions.size()},
+                        {slots.data(), slots.size()},
+                        {},
+                        {}};
+        if (engine == Engine::Teddy)
+        {
+            addTeddy();
+        }
+    }
+
+    /**
+     * @brief setEngine Selects the engine used to search complete texts.
+     * Engine::Teddy finds candidate positions of up to 64 keywords with packed
+     * nibble lookups (SSSE3 or AVX2 if enabled at compile time) and confirms
+     * them against the keywords. It reports the same matches in the same order
+     * as the automaton. Its tables are built by freeze, larger keyword sets,
+     * keywords with non ASCII case variants as well as streams and parallel
+     * searches always use the automaton.
+     * @param selected The engine to be used.
+     */
+    void setEngine(const Engine selected)
+    {
+        engine = selected;
+        teddy = Teddy();
+        if (engine == Engine::Teddy && isFrozen())
+        {
+            addTeddy();
+        }
+    }
+
+    /**
+     * @brief setMatchKind Selects which matches parseText, parseMatches and
+     * scan report for complete texts. The leftmost kinds report
+     * non-overlapping matches from left to right: of all matches starting at
+     * the leftmost position, the one of the earliest added or the longest
+     * keyword, after which the search resumes behind it. They are computed
+     * in a single walk of the automaton that never reads a character twice.
+     * Streams always report all matches.
+     * @param selected The kind of matches to be reported.
+     */
+    void setMatchKind(const MatchKind selected) { matchKind = selected; }
+
+    /**
+     * @brief isFrozen Returns whether searches run on the frozen representation.
+     */
+    bool isFrozen() const { return frozen.states.size != 0; }
+
+    /**
+     * @brief parseText Parses a text with the trie.
+     * @param text The text to be parsed.
+     * @return Returns a vector with all matches.
+     */
+    std::vector<Result> parseText(const std::string_view text) const
+    {
+        std::vector<Result> Results;
+        parseAll(text, [&](const std::size_t id, const std::size_t end, const std::size_t length) {
+            Results.emplace_back(keywordAt(id), id, end, length);
+            return true;
+        });
+        return Results;
+    }
+
+    /**
+     * @brief parseText Wrapper around parseText(std::string_view) for a raw
+     * character buffer.
+     * @param data Pointer to the first character of the text.
+     * @param size The number of characters in the text.
+     */
+    std::vector<Result> parseText(const char *data, const std::size_t size) const
+    {
+        return parseText(std::string_view(data, size));
+    }
+
+#if __cplusplus >= 202002L
+    /**
+     * @brief parseText Wrapper around parseText(std::string_view) for a byte
+     * buffer.
+     * @param bytes The bytes to be parsed.
+     */
+    std::vector<Result> parseText(const std::span<const std::byte> bytes) const
+    {
+        return parseText(asText(bytes));
+    }
+#endif
+
+    /**
+     * @brief parseMatches Parses a text with the trie without copying the
+     * found keywords.
+     * @param text The text to be parsed.
+     * @return Returns a vector with all matches.
+     */
+    std::vector<Match> parseMatches(const std::string_view text) const
+    {
+        std::vector<Match> Matches;
+        scan(text, [&](const Match &match) { Matches.push_back(match); });
+        return Matches;
+    }
+
+    /**
+     * @brief parseMatches Wrapper around parseMatches(std::string_view) for a
+     * raw character buffer.
+     * @param data Pointer to the first character of the text.
+     * @param size The number of characters in the text.
+     */
+    std::vector<Match> parseMatches(const char *data, const std::size_t size) const
+    {
+        return parseMatches(std::string_view(data, size));
+    }
+
+#if __cplusplus >= 202002L
+    /**
+     * @brief parseMatches Wrapper around parseMatches(std::string_view) for a
+     * byte buffer.
+     * @param bytes The bytes to be parsed.
+     */
+    std::vector<Match> parseMatches(const std::span<const std::byte> bytes) const
+    {
+        return parseMatches(asText(bytes));
+    }
+#endif
+
+    /**
+     * @brief parseMatchesParallel Parses a large text with several threads.
+     * The text is split into one chunk per thread and every chunk is parsed
+     * starting maxLength - 1 characters early, so that matches crossing a
+     * chunk boundary are found. A match belongs to the chunk containing its
+     * end position, so no match is reported twice.
+     * @param text The text to be parsed.
+     * @param threads The number of threads to use.
+     * @return Returns a vector with all matches in the same order as
+     * parseMatches.
+     */
+    std::vector<Match> parseMatchesParallel(const std::string_view text,
+                                            unsigned threads = std::thread::hardware_concurrency()) const
+    {
+        /* Splitting small texts costs more than it saves */
+        constexpr std::size_t minChunkSize = 1 << 16;
+        const std::size_t chunkCount =
+            std::max<std::size_t>(1, std::min<std::size_t>(threads, text.size() / minChunkSize));
+        /* Non-overlapping matches depend on all previous ones */
+        if (chunkCount == 1 || matchKind != MatchKind::All)
+        {
+            return parseMatches(text);
+        }
+        const std::size_t chunkSize = (text.size() + chunkCount - 1) / chunkCount;
+        const std::size_t overlap = maxLength > 0 ? maxLength - 1 : 0;
+
+        std::vector<std::future<std::vector<Match>>> chunks;
+        for (std::size_t begin = 0; begin < text.size(); begin += chunkSize)
+        {
+            chunks.push_back(std::async(std::launch::async, [this, text, begin, chunkSize, overlap]() {
+                const std::size_t end = std::min(text.size(), begin + chunkSize);
+                const std::size_t first = begin - std::min(begin, overlap);
+                std::vector<Match> Matches;
+                std::uint32_t state = 0;
+                parseKeywords(text.substr(first, end - first), state, first,
+                              [&](const std::size_t id, const std::size_t matchEnd,
+                                  const std::size_t length) {
+                                  if (matchEnd >= begin)
+                                  {
+                                      Matches.push_back(makeMatch(id, matchEnd, length));
+                                  }
+                                  return true;
+                              });
+                return Matches;
+            }));
+        }
+
+        std::vector<Match> Matches = chunks.front().get();
+        for (std::size_t chunk = 1; chunk < chunks.size(); chunk++)
+        {
+            const std::vector<Match> chunkMatches = chunks[chunk].get();
+            Matches.insert(Matches.end(), chunkMatches.begin(), chunkMatches.end());
+        }
+        return Matches;
+    }
+
+    /**
+     * @brief scan Parses a text with the trie and hands every match to a
+     * visitor as soon as it is found, without collecting the matches.
+     * @param text The text to be parsed.
+     * @param visitor Callable taking a const Match &. If it returns a value
+     * convertible to bool, returning false stops the scan.
+     * @return Returns false if the visitor stopped the scan, true otherwise.
+     */
+    template <typename Visitor>
+    bool scan(const std::string_view text, Visitor &&visitor) const
+    {
+        return parseAll(text, [&](const std::size_t id, const std::size_t end, const std::size_t length) {
+            return callVisitor(visitor, makeMatch(id, end, length));
+        });
+    }
+
+    /**
+     * @brief scan Wrapper around scan(std::string_view, Visitor) for a raw
+     * character buffer.
+     * @param data Pointer to the first character of the text.
+     * @param size The number of characters in the text.
+     * @param visitor Callable taking a const Match &.
+     */
+    template <typename Visitor>
+    bool scan(const char *data, const std::size_t size, Visitor &&visitor) const
+    {
+        return scan(std::string_view(data, size), std::forward<Visitor>(visitor));
+    }
+
+#if __cplusplus >= 202002L
+    /**
+     * @brief scan Wrapper around scan(std::string_view, Visitor) for a byte
+     * buffer.
+     * @param bytes The bytes to be parsed.
+     * @param visitor Callable taking a const Match &.
+     */
+    template <typename Visitor>
+    bool scan(const std::span<const std::byte> bytes, Visitor &&visitor) const
+    {
+        return scan(asText(bytes), std::forward<Visitor>(visitor));
+    }
+#endif
+
+    /**
+     * @brief countMatches Counts the matches of every keyword in a text
+     * without creating them. Texts that are long compared to the trie are
+     * parsed by counting how often every state is reached, and the output
+     * links of each reached state are followed once afterwards instead of
+     * once per visit.
+     * @param text The text to be parsed.
+     * @param counts The number of matches of every keyword is added to the
+     * entry of its index. It is enlarged to one entry per keyword if needed.
+     */
+    void countMatches(const std::string_view text, std::vector<std::uint64_t> &counts) const
+    {
+        counts.resize(std::max(counts.size(), keywordCount()));
+        const bool doubleArray = isFrozen() && layout == Layout::DoubleArray;
+        const std::size_t positions =
+            doubleArray ? frozen.slots.size : isFrozen() ? frozen.states.size : trieNodes.size();
+        if (matchKind != MatchKind::All || teddy.width != 0 || text.size() < positions)
+        {
+            parseAll(text, [&](const std::size_t id, const std::size_t, const std::size_t) {
+                counts[id]++;
+                return true;
+            });
+            return;
+        }
+        std::vector<std::uint64_t> visits(positions, 0);
+        if (isFrozen())
+        {
+            withLayout([&](const auto next, const auto stateOf) {
+                countVisits(text, visits, next);
+                for (std::uint32_t position = 1; position < positions; position++)
+                {
+                    if (visits[position] != 0)
+                    {
+                        const State *current = &frozen.states[stateOf(position)];
+                        if (current->id == -1)
+                        {
+                            current = &frozen.states[current->output];
+                        }
+                        for (; current->id != -1; current = &frozen.states[current->output])
+                        {
+                            counts[current->id] += visits[position];
+                        }
+                    }
+                }
+                return true;
+            });
+            return;
+        }
+        countVisits(text, visits, [this](const std::uint32_t current, const char character) {
+            return findChild(&trieNodes[current], fold(character))->index;
+        });
+        for (const Node &node : trieNodes)
+        {
+            if (visits[node.index] != 0)
+            {
+                const Node *current = node.id != -1 ? &node : node.output;
+                for (; current != root; current = current->output)
+                {
+                    counts[current->id] += visits[node.index];
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief countMatches Wrapper around countMatches(std::string_view,
+     * std::vector<std::uint64_t> &) for a raw character buffer.
+     * @param data Pointer to the first character of the text.
+     * @param size The number of characters in the text.
+     * @param counts The number of matches of every keyword is added to the
+     * entry of its index.
+     */
+    void countMatches(const char *data, const std::size_t size, std::vector<std::uint64_t> &counts) const
+    {
+        countMatches(std::string_view(data, size), counts);
+    }
+
+    /**
+     * @brief containsAny Returns whether a text contains any keyword. The
+     * search stops at the first state in which a keyword ends, so texts
+     * without a match are passed once without any output handling.
+     * @param text The text to be parsed.
+     */
+    bool containsAny(const std::string_view text) const { return firstKeyword(text) != -1; }
+
+    /**
+     * @brief containsAny Returns whether a text contains any keyword.
+     * @param text The text to be parsed.
+     * @param id Set to the index of the longest keyword of the first match to
+     * end in the text, unchanged if there is none.
+     */
+    bool containsAny(const std::string_view text, std::size_t &id) const
+    {
+        const std::int64_t found = firstKeyword(text);
+        if (found == -1)
+        {
+            return false;
+        }
+        id = static_cast<std::size_t>(found);
+        return true;
+    }
+
+    /**
+     * @brief The stream class carrying a search across consecutive chunks of
+     * a text. It only holds the current state and the absolute position, so
+     * a stream is valid for any trie as long as that trie is neither modified
+     * nor frozen with a different layout.
+     */
+    class stream
+    {
+      public:
+        /**
+         * @brief state Returns the current state of the automaton.
+         */
+        std::uint32_t state() const { return current; }
+
+        /**
+         * @brief offset Returns the absolute position of the next character.
+         */
+        std::size_t offset() const { return position; }
+
+        /**
+         * @brief reset Restarts the stream at the beginning of a new text.
+         */
+        void reset()
+        {
+            current = 0;
+            position = 0;
+        }
+
+      private:
+        friend class keyword_trie;
+        std::uint32_t current = 0; /**< The current state of the automaton */
+        std::size_t position = 0;  /**< The absolute position of the next character */
+    };
+
+    /**
+     * @brief scan Continues a search with the next chunk of a text. Matches are
+     * reported with their absolute position, including those that started in
+     * a previous chunk.
+     * @param context The stream carrying the search across chunks.
+     * @param chunk The next chunk of the text.
+     * @param visitor Callable taking a const Match &. If it returns a value
+     * convertible to bool, returning false stops the scan. The stream then
+     * continues after the character of the last reported match.
+     * @return Returns false if the visitor stopped the scan, true otherwise.
+     */
+    template <typename Visitor>
+    bool scan(stream &context, const std::string_view chunk, Visitor &&visitor) const
+    {
+        std::size_t stopped = 0;
+        const bool complete = parseKeywords(chunk, context.current, context.position,
+                                            [&](const std::size_t id, const std::size_t end,
+                                                const std::size_t length) {
+                                                if (callVisitor(visitor, makeMatch(id, end, length)))
+                                                {
+                                                    return true;
+                                                }
+                                                stopped = end + 1;
+                                                return false;
+                                            });
+        context.position = complete ? context.position + chunk.size() : stopped;
+        return complete;
+    }
+
+    /**
+     * @brief scanFile Searches the content of a file without reading it into
+     * memory. Regular files are memory mapped and searched in place, other
+     * files such as pipes are read in chunks through a stream.
+     * @param path The path of the file to be searched.
+     * @param visitor Callable taking a const Match &, the positions are file
+     * offsets. If it returns a value convertible to bool, returning false
+     * stops the scan.
+     * @return Returns false if the visitor stopped the scan, true otherwise.
+     */
+    template <typename Visitor>
+    bool scanFile(const std::string &path, Visitor &&visitor) const
+    {
+#if defined(__unix__) || defined(__APPLE__)
+        const FileDescriptor file(path);
+        struct stat info;
+        if (::fstat(file.fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0)
+        {
+            const std::size_t size = static_cast<std::size_t>(info.st_size);
+            void *data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file.fd, 0);
+            if (data != MAP_FAILED)
+            {
+                const MemoryMapping mapping{data, size};
+                ::madvise(data, size, MADV_SEQUENTIAL);
+                return scan(std::string_view(static_cast<const char *>(data), size), visitor);
+            }
+        }
+#else
+        const FileDescriptor file(path);
+#endif
+        stream context;
+        std::vector<char> buffer(1 << 16);
+        while (true)
+        {
+            const std::size_t size = file.read(buffer.data(), buffer.size());
+            if (size == 0)
+            {
+                return true;
+            }
+            if (!scan(context, std::string_view(buffer.data(), size), visitor))
+            {
+                return false;
+            }
+        }
+    }
+
+    /**
+     * @brief serialize Writes the frozen trie into a binary image. The image
+     * contains the frozen states, edges or tables, links and keywords and is
+     * independent of the address it is loaded at.
+     * @return The image.
+     */
+    std::vector<char> serialize() const
+    {
+        std::vector<char> bytes;
+        writeImage([&](const std::size_t size) {
+            bytes.assign(size, 0);
+            return bytes.data();
+        });
+        return bytes;
+    }
+
+    /**
+     * @brief save Writes the binary image of the frozen trie to a file.
+     * @param path The path of the file.
+     */
+    void save(const std::string &path) const
+    {
+        const std::vector<char> bytes = serialize();
+        std::FILE *file = std::fopen(path.c_str(), "wb");
+        if (file == nullptr)
+        {
+            throw std::runtime_error("Could not open the file " + path + ".");
+        }
+        const bool written = std::fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size();
+        const bool closed = std::fclose(file) == 0;
+        if (!written || !closed)
+        {
+            throw std::runtime_error("Failed to write the file " + path + ".");
+        }
+    }
+
+    /**
+     * @brief load Opens a binary image written by save. The file is memory
+     * mapped and searched in place, so only the header is checked and nothing
+     * is parsed or copied. A loaded trie can be searched but not modified.
+     * @param path The path of the file.
+     * @return The trie searching the image.
+     */
+    static keyword_trie load(const std::string &path)
+    {
+#if defined(__unix__) || defined(__APPLE__)
+        return mapImage(FileDescriptor(path), path);
+#else
+        const FileDescriptor file(path);
+        const auto buffer = std::make_shared<std::vector<char>>();
+        std::vector<char> chunk(1 << 16);
+        while (const std::size_t count = file.read(chunk.data(), chunk.size()))
+        {
+            buffer->insert(buffer->end(), chunk.begin(), chunk.begin() + count);
+        }
+        const std::shared_ptr<const void> owner(buffer, buffer->data());
+        keyword_trie trie;
+        trie.addImage(owner.get(), buffer->size());
+        trie.image = owner;
+        return trie;
+#endif
+    }
+
+    /**
+     * @brief attach Searches a binary image in memory owned by the caller, for
+     * example the result of serialize. The memory must stay valid and
+     * unchanged as long as the trie is used.
+     * @param data The start of the image, aligned to 8 bytes.
+     * @param size The size of the image.
+     * @return The trie searching the image.
+     */
+    static keyword_trie attach(const void *data, const std::size_t size)
+    {
+        keyword_trie trie;
+        trie.addImage(data, size);
+        trie.image = std::shared_ptr<const void>(data, [](const void *) {});
+        return trie;
+    }
+
+#if defined(__unix__) || defined(__APPLE__)
+    /**
+     * @brief publish Places the binary image of the frozen trie in a POSIX
+     * shared memory object. Other processes attach read only tries to it with
+     * attachShared and share its physical memory. An existing object is never
+     * replaced, as its readers would lose their pages. It has to be removed
+     * with unpublish first, tries attached to it keep working.
+     * @param name The name of the shared memory object, starting with '/'.
+     * @param mode The permissions of the object, only its owner by default.
+     */
+    void publish(const std::string &name, const mode_t mode = 0600) const
+    {
+        const int descriptor = ::shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, mode);
+        if (descriptor == -1 && errno == EEXIST)
+        {
+            throw std::runtime_error("The shared memory object " + name + " already exists.");
+        }
+        const FileDescriptor shared(descriptor, name);
+        std::unique_ptr<MemoryMapping> mapping;
+        try
+        {
+            writeImage([&](const std::size_t size) {
+                void *data = MAP_FAILED;
+                if (::ftruncate(shared.fd, static_cast<off_t>(size)) == 0)
+                {
+                    data = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, shared.fd, 0);
+                }
+                if (data == MAP_FAILED)
+                {
+                    throw std::runtime_error("Could not map the shared memory object " + name + ".");
+                }
+                mapping.reset(new MemoryMapping{data, size});
+                return static_cast<char *>(data);
+            });
+        }
+        catch (...)
+        {
+            ::shm_unlink(name.c_str());
+            throw;
+        }
+    }
+
+    /**
+     * @brief attachShared Searches an image published by another process.
+     * @param name The name of the shared memory object.
+     * @return The trie searching the shared image.
+     */
+    static keyword_trie attachShared(const std::string &name)
+    {
+        return mapImage(FileDescriptor(::shm_open(name.c_str(), O_RDONLY, 0), name), name);
+    }
+
+    /**
+     * @brief unpublish Removes a shared memory object created by publish.
+     * @param name The name of the shared memory object.
+     */
+    static void unpublish(const std::string &name)
+    {
+        if (::shm_unlink(name.c_str()) != 0)
+        {
+            throw std::runtime_error("Could not remove the shared memory object " + name + ".");
+        }
+    }
+#endif
+
+  private:
+#if defined(__unix__) || defined(__APPLE__)
+    /**
+     * @brief The FileDescriptor struct owning a file opened for reading.
+     */
+    struct FileDescriptor
+    {
+        int fd; /**< The file descriptor */
+
+        explicit FileDescriptor(const std::string &path)
+            : FileDescriptor(::open(path.c_str(), O_RDONLY), path)
+        {
+        }
+        explicit FileDescriptor(const int descriptor, const std::string &path) : fd(descriptor)
+        {
+            if (fd == -1)
+            {
+                throw std::runtime_error("Could not open the file " + path + ".");
+            }
+        }
+        FileDescriptor(const FileDescriptor &) = delete;
+        FileDescriptor &operator=(const FileDescriptor &) = delete;
+        ~FileDescriptor() { ::close(fd); }
+
+        /**
+         * @brief read Reads the next chunk of the file.
+         * @return The number of characters read, 0 at the end of the file.
+         */
+        std::size_t read(char *buffer, const std::size_t size) const
+        {
+            while (true)
+            {
+                const ssize_t count = ::read(fd, buffer, size);
+                if (count >= 0)
+                {
+                    return static_cast<std::size_t>(count);
+                }
+                if (errno != EINTR)
+                {
+                    throw std::runtime_error("Failed to read the file.");
+                }
+            }
+        }
+    };
+
+    /**
+     * @brief The MemoryMapping struct owning a memory mapped file.
+     */
+    struct MemoryMapping
+    {
+        void *data;       /**< The start of the mapping */
+        std::size_t size; /**< The size of the mapping */
+
+        MemoryMapping(const MemoryMapping &) = delete;
+        MemoryMapping &operator=(const MemoryMapping &) = delete;
+        ~MemoryMapping() { ::munmap(data, size); }
+    };
+
+    /**
+     * @brief mapImage Memory maps a binary image read only.
+     * @param file The opened image.
+     * @param path The name of the image.
+     * @return The trie searching the mapping.
+     */
+    static keyword_trie mapImage(const FileDescriptor &file, const std::string &path)
+    {
+        struct stat info;
+        if (::fstat(file.fd, &info) != 0 || static_cast<std::size_t>(info.st_size) < sizeof(ImageHeader))
+        {
+            throw std::runtime_error("The file " + path + " is not a keyword trie image.");
+        }
+        const std::size_t size = static_cast<std::size_t>(info.st_size);
+        void *data = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, file.fd, 0);
+        if (data == MAP_FAILED)
+        {
+            throw std::runtime_error("Could not map the file " + path + ".");
+        }
+        const std::shared_ptr<const MemoryMapping> mapping(new MemoryMapping{data, size});
+        keyword_trie trie;
+        trie.addImage(data, size);
+        trie.image = std::shared_ptr<const void>(mapping, data);
+        return trie;
+    }
+#else
+    /**
+     * @brief The FileDescriptor struct owning a file opened for reading.
+     */
+    struct FileDescriptor
+    {
+        std::FILE *file; /**< The file handle */
+
+        explicit FileDescriptor(const std::string &path) : file(std::fopen(path.c_str(), "rb"))
+        {
+            if (file == nullptr)
+            {
+                throw std::runtime_error("Could not open the file " + path + ".");
+            }
+        }
+        FileDescriptor(const FileDescriptor &) = delete;
+        FileDescriptor &operator=(const FileDescriptor &) = delete;
+        ~FileDescriptor() { std::fclose(file); }
+
+        /**
+         * @brief read Reads the next chunk of the file.
+         * @return The number of characters read, 0 at the end of the file.
+         */
+        std::size_t read(char *buffer, const std::size_t size) const
+        {
+            const std::size_t count = std::fread(buffer, 1, size, file);
+            if (count == 0 && std::ferror(file))
+            {
+                throw std::runtime_error("Failed to read the file.");
+            }
+            return count;
+        }
+    };
+#endif
+
+#if __cplusplus >= 202002L
+    /**
+     * @brief asText Views a byte buffer as characters.
+     */
+    static std::string_view asText(const std::span<const std::byte> bytes)
+    {
+        return std::string_view(reinterpret_cast<const char *>(bytes.data()), bytes.size());
+    }
+#endif
+
+    /**
+     * @brief addRoot Creates the root Node of an empty trie.
+     */
+    void addRoot()
+    {
+        trieNodes.emplace_back();
+        root = &trieNodes.front();
+        root->parent = root;
+        root->failure = root;
+        root->output = root;
+    }
+
+    /**
+     * @brief isRemoved Returns whether the keyword with a given index was
+     * removed.
+     */
+    bool isRemoved(const std::size_t id) const { return id < removed.size() && removed[id]; }
+
+    /**
+     * @brief keywordCount Returns the number of keywords.
+     */
+    std::size_t keywordCount() const
+    {
+        return image ? frozen.keywordOffsets.size - 1 : keywords.size();
+    }
+
+    /**
+     * @brief keywordAt Returns the keyword with a given index.
+     */
+    std::string_view keywordAt(const std::size_t id) const
+    {
+        if (image)
+        {
+            const std::uint64_t first = frozen.keywordOffsets[id];
+            return std::string_view(frozen.keywordChars.data + first,
+                                    frozen.keywordOffsets[id + 1] - first);
+        }
+        return keywords[id].keyword;
+    }
+
+    /**
+     * @brief writeImage Writes the binary image of the frozen trie. The header
+     * is written last, so an image that is read while it is written is
+     * rejected.
+     * @param allocate Called with the size of the image, returns the zero
+     * initialized memory the image is written to.
+     */
+    template <typename Allocate>
+    void writeImage(Allocate allocate) const
+    {
+        if (!isFrozen())
+        {
+            throw std::runtime_error("Attempted to serialize a keyword trie that is not frozen.");
+        }
+        std::vector<std::uint64_t> keywordOffsets(keywordCount() + 1, 0);
+        for (std::size_t id = 0; id + 1 < keywordOffsets.size(); id++)
+        {
+            keywordOffsets[id + 1] = keywordOffsets[id] + keywordAt(id).size();
+        }
+
+        ImageHeader header;
+        header.layout = static_cast<std::uint32_t>(layout);
+        header.classCount = classCount;
+        header.maxLength = maxLength;
+        header.byteClasses = byteClasses;
+        std::copy(startSet.begin(), startSet.end(), header.startSet.begin());
+        const std::array<std::pair<const void *, std::size_t>, ImageHeader::SectionCount> sections{{
+            {frozen.states.data, frozen.states.size * sizeof(State)},
+            {frozen.edgeLabels.data, frozen.edgeLabels.size},
+            {frozen.edgeTargets.data, frozen.edgeTargets.size * sizeof(std::uint32_t)},
+            {frozen.edgeSets.data, frozen.edgeSets.size * sizeof(LabelSet)},
+            {frozen.transitions.data, frozen.transitions.size * sizeof(std::uint32_t)},
+            {frozen.slots.data, frozen.slots.size * sizeof(Slot)},
+            {keywordOffsets.data(), keywordOffsets.size() * sizeof(std::uint64_t)},
+            {nullptr, keywordOffsets.back()},
+        }};
+        const std::array<std::size_t, ImageHeader::SectionCount> counts{
+            frozen.states.size, frozen.edgeLabels.size, frozen.edgeTargets.size,
+            frozen.edgeSets.size, frozen.transitions.size, frozen.slots.size,
+            keywordOffsets.size(), keywordOffsets.back()};
+
+        /* Every section starts on a cache line */
+        const auto align = [](const std::size_t position) { return (position + 63) & ~std::size_t(63); };
+        std::size_t position = align(sizeof(ImageHeader));
+        for (std::size_t section = 0; section < sections.size(); section++)
+        {
+            header.offsets[section] = position;
+            header.counts[section] = counts[section];
+            position = align(position + sections[section].second);
+        }
+        header.size = position;
+
+        char *bytes = allocate(position);
+        for (std::size_t section = 0; section < sections.size(); section++)
+        {
+            if (sections[section].first != nullptr && sections[section].second != 0)
+            {
+                std::memcpy(bytes + header.offsets[section], sections[section].first,
+                            sections[section].second);
+            }
+        }
+        for (std::size_t id = 0; id + 1 < keywordOffsets.size(); id++)
+        {
+            const std::string_view key = keywordAt(id);
+            std::copy(key.begin(), key.end(),
+                      bytes + header.offsets[ImageHeader::KeywordChars] + keywordOffsets[id]);
+        }
+        std::atomic_thread_fence(std::memory_order_release);
+        std::memcpy(bytes, &header, sizeof(ImageHeader));
+    }
+
+    /**
+     * @brief addImage Points the frozen views into a binary image. Only the
+     * header and the bounds of the sections are checked, the content of the
+     * image is trusted.
+     * @param data The start of the image.
+     * @param size The size of the image.
+     */
+    void addImage(const void *data, const std::size_t size)
+    {
+        const char *bytes = static_cast<const char *>(data);
+        const auto invalid = []() { return std::runtime_error("The data is not a valid keyword trie image."); };
+        if (reinterpret_cast<std::uintptr_t>(data) % alignof(std::uint64_t) != 0 || size < sizeof(ImageHeader))
+        {
+            throw invalid();
+        }
+        ImageHeader header;
+        std::memcpy(&header, bytes, sizeof(ImageHeader));
+        if (header.magic != ImageHeader::signature || header.version != ImageHeader::currentVersion ||
+            header.byteOrder != ImageHeader::nativeOrder || header.caseSensitive != CaseSensitive ||
+            header.layout > static_cast<std::uint32_t>(Layout::DoubleArray) || header.size > size)
+        {
+            throw invalid();
+        }
+        /* Pairs with the release fence in writeImage, the header is written last */
+        std::atomic_thread_fence(std::memory_order_acquire);
+        const auto section = [&](auto &table, const typename ImageHeader::Section index) {
+            using Element = std::remove_const_t<std::remove_pointer_t<decltype(table.data)>>;
+            const std::uint64_t offset = header.offsets[index];
+            const std::uint64_t count = header.counts[index];
+            if (offset % alignof(Element) != 0 || offset > header.size ||
+                count > (header.size - offset) / sizeof(Element))
+            {
+                throw invalid();
+            }
+            table.data = reinterpret_cast<const Element *>(bytes + offset);
+            table.size = count;
+        };
+        Frozen views;
+        section(views.states, ImageHeader::States);
+        section(views.edgeLabels, ImageHeader::EdgeLabels);
+        section(views.edgeTargets, ImageHeader::EdgeTargets);
+        section(views.edgeSets, ImageHeader::EdgeSets);
+        section(views.transitions, ImageHeader::Transitions);
+        section(views.slots, ImageHeader::Slots);
+        section(views.keywordOffsets, ImageHeader::KeywordOffsets);
+        section(views.keywordChars, ImageHeader::KeywordChars);
+        if (views.states.size == 0 || views.keywordOffsets.size == 0 ||
+            views.keywordOffsets[views.keywordOffsets.size - 1] > views.keywordChars.size)
+        {
+            throw invalid();
+        }
+
+        frozen = views;
+        layout = static_cast<Layout>(header.layout);
+        classCount = header.classCount;
+        maxLength = header.maxLength;
+        byteClasses = header.byteClasses;
+        startBytes.clear();
+        for (std::size_t character = 0; character < startSet.size(); character++)
+        {
+            startSet[character] = header.startSet[character] != 0;
+            if (startSet[character])
+            {
+                startBytes.push_back(static_cast<char>(character));
+            }
+        }
+    }
+
+    /**
+     * @brief makeMatch Creates the Match of a keyword ending at a position.
+     */
+    Match makeMatch(const std::size_t id, const std::size_t end, const std::size_t length) const
+    {
+        return Match{id, end + 1 - length, end, keywordAt(id)};
+    }
+
+    /**
+     * @brief callVisitor Hands a match to a visitor.
+     * @return Returns false if the visitor asked to stop the search.
+     */
+    template <typename Visitor>
+    static bool callVisitor(Visitor &visitor, const Match &match)
+    {
+        if constexpr (std::is_void_v<std::invoke_result_t<Visitor &, const Match &>>)
+        {
+            visitor(match);
+            return true;
+        }
+        else
+        {
+            return static_cast<bool>(visitor(match));
+        }
+    }
+
+    /**
+     * @brief parseAll Parses a complete text with the selected engine.
+     * @param text The text to be parsed.
+     * @param report Called with the keyword index, end position and length of
+     * a match, returns false to stop the search.
+     * @return Returns false if the search was stopped, true otherwise.
+     */
+    template <typename Report>
+    bool parseAll(const std::string_view text, Report report) const
+    {
+        if (matchKind != MatchKind::All)
+        {
+            return parseLeftmost(text, report);
+        }
+        if (teddy.width != 0)
+        {
+            return parseTeddy(text, report);
+        }
+        std::uint32_t state = 0;
+        return parseKeywords(text, state, 0, report);
+    }
+
+    /**
+     * @brief parseKeywords Parses a text with the trie and reports every match.
+     * @param text The text to be parsed.
+     * @param state The state to start in, updated to the state after the last
+     * parsed character.
+     * @param offset The absolute position of the first character of text.
+     * @param report Called with the keyword index, absolute end position and
+     * length of a match, returns false to stop the search.
+     * @return Returns false if the search was stopped, true otherwise.
+     */
+    template <typename Report>
+    bool parseKeywords(const std::string_view text, std::uint32_t &state, const std::size_t offset,
+                       Report report) const
+    {
+        if (text.empty())
+        {
+            return true;
+        }
+        if (isFrozen())
+        {
+            return withLayout([&](const auto next, const auto stateOf) {
+                return parseStates(text, state, offset, report, next, stateOf);
+            });
+        }
+        const Node *current = &trieNodes[state];
+        for (size_t i = 0; i < text.size(); i++)
+        {
+            if (current == root)
+            {
+                i = skipToStart(text, i);
+                if (i == text.size())
+                {
+                    break;
+                }
+            }
+            current = findChild(current, fold(text[i]));
+            if (current->id != -1 && !report(current->id, offset + i, current->depth))
+            {
+                state = current->index;
+                return false;
+            }
+            /* Process the output links for possible additional matches */
+            const Node *temp = current->output;
+            while (temp != root)
+            {
+                if (!report(temp->id, offset + i, temp->depth))
+                {
+                    state = current->index;
+                    return false;
+                }
+                temp = temp->output;
+            }
+        }
+        state = current->index;
+        return true;
+    }
+
+    /**
+     * @brief addChild Add a child Node to the trie.
+     * @param parrent The pointer to the parrent Node of the new one.
+     * @param character The character on the edge to the new Node.
+     * @return The pointer to the newly created Node.
+     */
+    Node *addChild(Node *current, const char &character)
+    {
+        if (Node *child = getChild(current, character))
+        {
+            return child;
+        }
+        trieNodes.emplace_back(trieNodes.size(),
+                               current->depth + 1,
+                               character,
+                               current,
+                               root);
+        current->children.insert(current->children.begin() + current->labels.rank(character),
+                                 &trieNodes.back());
+        current->labels.insert(character);
+        return &trieNodes.back();
+    }
+
+    /**
+     * @brief fold Returns a character of the text as it labels the edges of
+     * the trie, which is its lower case without case sensitivity.
+     */
+    static char fold(const char character)
+    {
+        return CaseSensitive ? character : foldTable[static_cast<unsigned char>(character)];
+    }
+
+    /**
+     * @brief hasVariants Returns whether a keyword is expanded into the byte
+     * sequences of its case variants. Without case sensitivity this is the
+     * case for keywords with non ASCII characters, unless they have more than
+     * maxVariants variants. ASCII keywords are only expanded so that "ss" also
+     * matches the sharp s, if that gives at most maxSharpVariants variants.
+     */
+    static bool hasVariants(const std::string &key)
+    {
+        if (CaseSensitive)
+        {
+            return false;
+        }
+        if (isAscii(key))
+        {
+            return foldKey(key).find("ss") != std::string::npos &&
+                   countVariants(foldVariants(key)) <= maxSharpVariants;
+        }
+        return countVariants(foldVariants(key)) <= maxVariants;
+    }
+
+    /**
+     * @brief isAscii Returns whether a keyword consists of ASCII characters only.
+     */
+    static bool isAscii(const std::string &key)
+    {
+        return std::none_of(key.begin(), key.end(),
+                            [](const char character) { return static_cast<unsigned char>(character) >= 0x80; });
+    }
+
+    /**
+     * @brief countVariants Returns the number of byte sequences matching the
+     * units of a keyword, at most maxVariants + 1.
+     * @param units The variants of every case folded code point.
+     */
+    static std::size_t countVariants(const std::vector<std::vector<std::string>> &units)
+    {
+        /* Number of variants of the units from a position on, "ss" also matches ß and ẞ */
+        std::vector<std::size_t> count(units.size() + 2, 0);
+        count[units.size()] = 1;
+        for (std::size_t pos = units.size(); pos-- > 0;)
+        {
+            const bool sharpS = pos + 1 < units.size() && units[pos][0] == "s" && units[pos + 1][0] == "s";
+            count[pos] = std::min(maxVariants + 1,
+                                  count[pos + 1] * units[pos].size() + (sharpS ? 2 * count[pos + 2] : 0));
+        }
+        return count[0];
+    }
+
+    /**
+     * @brief decodeUtf8 Decodes the code point starting at a position of a key.
+     * @param key The keyword.
+     * @param pos The position of the first byte of the code point.
+     * @param codePoint Set to the decoded code point.
+     * @return The number of bytes of the code point or 0 if they are not valid
+     * UTF-8.
+     */
+    static std::size_t decodeUtf8(const std::string &key, const std::size_t pos, char32_t &codePoint)
+    {
+        const unsigned char lead = static_cast<unsigned char>(key[pos]);
+        const std::size_t length = lead < 0x80   ? 1
+                                   : lead < 0xC2 ? 0
+                                   : lead < 0xE0 ? 2
+                                   : lead < 0xF0 ? 3
+                                   : lead < 0xF5 ? 4
+                                                 : 0;
+        if (length == 0 || pos + length > key.size())
+        {
+            return 0;
+        }
+        codePoint = length == 1 ? lead : lead & (0x7F >> length);
+        for (std::size_t k = 1; k < length; k++)
+        {
+            const unsigned char next = static_cast<unsigned char>(key[pos + k]);
+            if ((next & 0xC0) != 0x80)
+            {
+                return 0;
+            }
+            codePoint = (codePoint << 6) | (next & 0x3F);
+        }
+        /* Overlong encodings, surrogates and code points beyond Unicode */
+        if ((length == 3 && (codePoint < 0x800 || (codePoint >= 0xD800 && codePoint <= 0xDFFF))) ||
+            (length == 4 && (codePoint < 0x10000 || codePoint > 0x10FFFF)))
+        {
+            return 0;
+        }
+        return length;
+    }
+
+    /**
+     * @brief encodeUtf8 Returns the UTF-8 encoding of a code point.
+     */
+    static std::string encodeUtf8(const char32_t codePoint)
+    {
+        std::string bytes;
+        if (codePoint < 0x80)
+        {
+            bytes += static_cast<char>(codePoint);
+        }
+        else if (codePoint < 0x800)
+        {
+            bytes += static_cast<char>(0xC0 | (codePoint >> 6));
+            bytes += static_cast<char>(0x80 | (codePoint & 0x3F));
+        }
+        else if (codePoint < 0x10000)
+        {
+            bytes += static_cast<char>(0xE0 | (codePoint >> 12));
+            bytes += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+            bytes += static_cast<char>(0x80 | (codePoint & 0x3F));
+        }
+        else
+        {
+            bytes += static_cast<char>(0xF0 | (codePoint >> 18));
+            bytes += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+            bytes += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+            bytes += static_cast<char>(0x80 | (codePoint & 0x3F));
+        }
+        return bytes;
+    }
+
+    /**
+     * @brief foldCodePoint Returns the simple case folding of a code point.
+     */
+    static char32_t foldCodePoint(const char32_t codePoint)
+    {
+        if (codePoint < 0x80)
+        {
+            return static_cast<unsigned char>(fold(static_cast<char>(codePoint)));
+        }
+        for (const FoldRange &range : foldRanges)
+        {
+            if (codePoint >= range.first && codePoint <= range.last &&
+                (codePoint - range.first) % range.stride == 0)
+            {
+                return codePoint + range.delta;
+            }
+        }
+        return codePoint;
+    }
+
+    /**
+     * @brief foldVariants Splits a keyword into its case folded code points
+     * and lists the byte sequences of the text that match each of them: the
+     * UTF-8 encodings of all code points with the same simple case folding.
+     * ASCII letters are only listed in lower case, as the text is folded by
+     * fold anyway, and keywords without non ASCII characters only get their
+     * ASCII characters. The sharp s is split into "ss", invalid UTF-8 is kept
+     * as single bytes.
+     */
+    static std::vector<std::vector<std::string>> foldVariants(const std::string &key)
+    {
+        std::vector<std::vector<std::string>> units;
+        if (isAscii(key))
+        {
+            for (const char character : foldKey(key))
+            {
+                units.push_back({std::string(1, character)});
+            }
+            return units;
+        }
+        for (std::size_t pos = 0; pos < key.size();)
+        {
+            char32_t codePoint = 0;
+            const std::size_t length = decodeUtf8(key, pos, codePoint);
+            if (length == 0)
+            {
+                units.push_back({std::string(1, key[pos])});
+                pos++;
+                continue;
+            }
+            pos += length;
+            const char32_t folded = foldCodePoint(codePoint);
+            if (folded == 0xDF)
+            {
+                units.push_back({"s", encodeUtf8(0x17F)});
+                units.push_back(units.back());
+                continue;
+            }
+            std::vector<std::string> unit{encodeUtf8(folded)};
+            for (const FoldRange &range : foldRanges)
+            {
+                const char32_t source = folded - range.delta;
+                if (source >= 0x80 && source >= range.first && source <= range.last &&
+                    (source - range.first) % range.stride == 0)
+                {
+                    unit.push_back(encodeUtf8(source));
+                }
+            }
+            units.push_back(std::move(unit));
+        }
+        return units;
+    }
+
+    /**
+     * @brief addKeyword Adds the Nodes of a keyword and marks them with its
+     * index. Keywords with case variants get one path per variant, all other
+     * keywords a single path of their case folded characters.
+     * @param key The keyword.
+     * @param id The index of the keyword.
+     * @return The Nodes marked with the index.
+     */
+    std::vector<Node *> addKeyword(const std::string &key, const std::size_t id)
+    {
+        std::vector<Node *> terminals;
+        if (!hasVariants(key))
+        {
+            Node *current = root;
+            for (const char character : foldKey(key))
+            {
+                current = addChild(current, character);
+            }
+            if (current->id != -1)
+            {
+                throw std::runtime_error(
+                    "Attempted to add two identical strings to the keyword tree.");
+            }
+            current->id = id;
+            terminals.push_back(current);
+            maxLength = std::max(maxLength, key.size());
+            return terminals;
+        }
+
+        const std::vector<std::vector<std::string>> units = foldVariants(key);
+        const auto child = [this](Node *current, const char character) {
+            return addChild(current, character);
+        };
+        const auto terminal = [&](Node *current) {
+            if (current->id != -1)
+            {
+                throw std::runtime_error(
+                    "Attempted to add two identical strings to the keyword tree.");
+            }
+            current->id = id;
+            terminals.push_back(current);
+            maxLength = std::max<std::size_t>(maxLength, current->depth);
+        };
+        try
+        {
+            walkVariants(root, units, 0, child, terminal);
+        }
+        catch (...)
+        {
+            for (Node *marked : terminals)
+            {
+                marked->id = -1;
+            }
+            throw;
+        }
+        return terminals;
+    }
+
+    /**
+     * @brief walkVariants Follows the paths of all variants of the remaining
+     * units of a keyword below a Node.
+     * @param current The pointer to the Node reached so far.
+     * @param units The variants of every case folded code point.
+     * @param pos The next unit.
+     * @param child Returns the child of a Node for a character, or nullptr to
+     * abandon the path.
+     * @param terminal Called with the last Node of every variant.
+     */
+    template <typename Child, typename Terminal>
+    static void walkVariants(Node *current, const std::vector<std::vector<std::string>> &units,
+                             const std::size_t pos, const Child &child, const Terminal &terminal)
+    {
+        if (pos == units.size())
+        {
+            terminal(current);
+            return;
+        }
+        const auto followPath = [&](const std::string &bytes, const std::size_t next) {
+            Node *node = current;
+            for (const char character : bytes)
+            {
+                node = child(node, character);
+                if (node == nullptr)
+                {
+                    return;
+                }
+            }
+            walkVariants(node, units, next, child, terminal);
+        };
+        for (const std::string &bytes : units[pos])
+        {
+            followPath(bytes, pos + 1);
+        }
+        if (pos + 1 < units.size() && units[pos][0] == "s" && units[pos + 1][0] == "s")
+        {
+            followPath(encodeUtf8(0xDF), pos + 2);
+            followPath(encodeUtf8(0x1E9E), pos + 2);
+        }
+    }
+
+    /**
+     * @brief findKeyword Looks up the Nodes marked with the index of a keyword.
+     * @param key The keyword.
+     * @return The Nodes of all variants of the keyword, empty if it is not in
+     * the trie.
+     */
+    std::vector<Node *> findKeyword(const std::string &key) const
+    {
+        std::vector<Node *> terminals;
+        if (!hasVariants(key))
+        {
+            Node *current = root;
+            for (const char character : foldKey(key))
+            {
+                current = getChild(current, character);
+                if (current == nullptr)
+                {
+                    return terminals;
+                }
+            }
+            if (current->id != -1)
+            {
+                terminals.push_back(current);
+            }
+            return terminals;
+        }
+        walkVariants(root, foldVariants(key), 0, getChild, [&](Node *current) {
+            if (current->id != -1)
+            {
+                terminals.push_back(current);
+            }
+        });
+        return terminals;
+    }
+
+    /**
+     * @brief foldKey Returns the characters of a keyword as they label the
+     * edges of the trie.
+     */
+    static std::string foldKey(const std::string &key)
+    {
+        std::string folded = key;
+        if (!CaseSensitive)
+        {
+            std::transform(folded.begin(), folded.end(), folded.begin(), fold);
+        }
+        return folded;
+    }
+
+    /**
+     * @brief addStrings Inserts a list of keywords in one pass over the sorted
+     * keys. Consecutive keys share their common prefix, so only the new
+     * suffix of every key is looked up or created, and the failure links are
+     * computed once at the end. Keyword indices follow the order of keyList,
+     * just like repeated calls of addString. If a key is added twice, none of
+     * the keys is kept.
+     * @param keyList The container with the keys.
+     * @param isSorted Flag to signal that keyList is already sorted by its case
+     * folded keys.
+     * @param threads The number of threads computing the failure links.
+     */
+    template <typename KeyList>
+    void addStrings(const KeyList &keyList, const bool isSorted, const unsigned threads)
+    {
+        std::vector<std::string> folded;
+        std::vector<std::size_t> ids;
+        /* Keywords with case variants are added separately, one path per variant */
+        std::vector<std::pair<const std::string *, std::size_t>> variantKeys;
+        std::size_t nextId = keywords.size();
+        for (const std::string &key : keyList)
+        {
+            if (key.empty())
+            {
+                continue;
+            }
+            if (hasVariants(key))
+            {
+                variantKeys.emplace_back(&key, nextId++);
+            }
+            else
+            {
+                folded.push_back(foldKey(key));
+                ids.push_back(nextId++);
+            }
+        }
+        std::vector<std::size_t> order(folded.size());
+        for (std::size_t rank = 0; rank < order.size(); rank++)
+        {
+            order[rank] = rank;
+        }
+        const auto byKey = [&](const std::size_t lhs, const std::size_t rhs) {
+            return folded[lhs] < folded[rhs];
+        };
+        if (!isSorted)
+        {
+            std::sort(order.begin(), order.end(), byKey);
+        }
+        else if (!std::is_sorted(order.begin(), order.end(), byKey))
+        {
+            throw std::runtime_error("Attempted to add an unsorted list of strings as sorted.");
+        }
+
+        thaw();
+        const std::size_t firstId = keywords.size();
+        const std::size_t previousLength = maxLength;
+        for (const std::string &key : keyList)
+        {
+            if (!key.empty())
+            {
+                keywords.emplace_back(key, keywords.size());
+                maxLength = std::max(maxLength, key.size());
+            }
+        }
+
+        std::vector<Node *> marked;
+        try
+        {
+            std::vector<Node *> path{root};
+            std::string_view previous;
+            for (const std::size_t rank : order)
+            {
+                const std::string_view key = folded[rank];
+                std::size_t shared = 0;
+                while (shared < previous.size() && shared < key.size() &&
+                       previous[shared] == key[shared])
+                {
+                    shared++;
+                }
+                path.resize(shared + 1);
+                for (std::size_t pos = shared; pos < key.size(); pos++)
+                {
+                    path.push_back(addChild(path.back(), key[pos]));
+                }
+                if (path.back()->id != -1)
+                {
+                    throw std::runtime_error(
+                        "Attempted to add two identical strings to the keyword tree.");
+                }
+                path.back()->id = ids[rank];
+                marked.push_back(path.back());
+                previous = key;
+            }
+            for (const auto &[key, id] : variantKeys)
+            {
+                const std::vector<Node *> terminals = addKeyword(*key, id);
+                marked.insert(marked.end(), terminals.begin(), terminals.end());
+            }
+        }
+        catch (...)
+        {
+            /* None of the keys is kept, the Nodes created so far only need their links */
+            for (Node *node : marked)
+            {
+                node->id = -1;
+            }
+            while (keywords.size() > firstId)
+            {
+                keywords.pop_back();
+            }
+            maxLength = previousLength;
+            addFailureLinks(threads);
+            throw;
+        }
+        addFailureLinks(threads);
+    }
+
+    /**
+     * @brief getChild Looks up the child Node with a given label.
+     * @param current The pointer to the parent Node.
+     * @param character The label of the child.
+     * @return The pointer to the child or nullptr if there is none.
+     */
+    static Node *getChild(const Node *current, const char character)
+    {
+        if (!current->labels.contains(character))
+        {
+            return nullptr;
+        }
+        return current->children[current->labels.rank(character)];
+    }
+
+    /**
+     * @brief popCount Returns the number of set bits.
+     */
+    static unsigned popCount(const std::uint64_t bits)
+    {
+#if defined(_MSC_VER) && defined(_M_X64)
+        return static_cast<unsigned>(__popcnt64(bits));
+#elif defined(_MSC_VER)
+        return __popcnt(static_cast<std::uint32_t>(bits)) +
+               __popcnt(static_cast<std::uint32_t>(bits >> 32));
+#else
+        return __builtin_popcountll(bits);
+#endif
+    }
+
+    /**
+     * @brief addFailureLinks Utilize a breadth first search to generate the
+     * failure links. The fallbacks are rebuilt afterwards in one pass.
+     */
+    void addFailureLinks()
+    {
+        std::queue<Node *> q;
+        q.push(root);
+        while (!q.empty())
+        {
+            Node *temp = q.front();
+            for (Node *child : temp->children)
+            {
+                q.push(child);
+            }
+            /* A failure link with just one less charater is the optimum and will
+             * never change.
+             */
+            if (temp->failure->depth < temp->depth - 1)
+            {
+                temp->failure = findFailure(temp);
+            }
+
+            /* Process the failure links for possible additional matches */
+            Node *out = temp->failure;
+            while (out != root)
+            {
+                if (out->id != -1)
+                {
+                    break;
+                }
+                out = out->failure;
+            }
+            temp->output = out;
+            q.pop();
+        }
+        addFallbacks();
+        linksPending = false;
+        addStartBytes();
+    }
+
+    /**
+     * @brief addFailureLinks Generates the failure links one depth at a time.
+     * The failure and output links of a Node only depend on Nodes of smaller
+     * depth, so all Nodes of one depth are independent and are split among
+     * the threads.
+     * @param threads The number of threads to use.
+     */
+    void addFailureLinks(const unsigned threads)
+    {
+        if (threads <= 1)
+        {
+            addFailureLinks();
+            return;
+        }
+
+        /* Nodes in breadth first order, depth d spans levels[d] to levels[d + 1] */
+        std::vector<Node *> order{root};
+        std::vector<std::size_t> levels{0};
+        for (std::size_t begin = 0; begin < order.size();)
+        {
+            const std::size_t end = order.size();
+            levels.push_back(end);
+            for (std::size_t pos = begin; pos < end; pos++)
+            {
+                order.insert(order.end(), order[pos]->children.begin(), order[pos]->children.end());
+            }
+            begin = end;
+        }
+
+        const auto linkNodes = [this, &order](const std::size_t first, const std::size_t last) {
+            for (std::size_t pos = first; pos < last; pos++)
+            {
+                Node *temp = order[pos];
+                temp->failure = findFailure(temp);
+                temp->output = temp->failure->id != -1 ? temp->failure : temp->failure->output;
+            }
+        };
+
+        /* Splitting small levels costs more than it saves */
+        constexpr std::size_t minChunkSize = 1 << 12;
+        std::vector<std::future<void>> chunks;
+        for (std::size_t depth = 1; depth + 1 < levels.size(); depth++)
+        {
+            const std::size_t first = levels[depth];
+            const std::size_t last = levels[depth + 1];
+            const std::size_t chunkCount =
+                std::max<std::size_t>(1, std::min<std::size_t>(threads, (last - first) / minChunkSize));
+            const std::size_t chunkSize = (last - first + chunkCount - 1) / chunkCount;
+            for (std::size_t begin = first + chunkSize; begin < last; begin += chunkSize)
+            {
+                chunks.push_back(std::async(std::launch::async, linkNodes, begin,
+                                            std::min(last, begin + chunkSize)));
+            }
+            linkNodes(first, std::min(last, first + chunkSize));
+            for (std::future<void> &chunk : chunks)
+            {
+                chunk.get();
+            }
+            chunks.clear();
+        }
+
+        addFallbacks();
+        linksPending = false;
+        addStartBytes();
+    }
+
+    /**
+     * @brief addFallbacks Rebuilds the fallbacks of all Nodes from their
+     * failure links in one pass, after the failure links were recomputed.
+     */
+    void addFallbacks()
+    {
+        for (Node &temp : trieNodes)
+        {
+            temp.fallbacks.clear();
+        }
+        for (Node &temp : trieNodes)
+        {
+            if (&temp != root)
+            {
+                temp.failSlot = static_cast<std::uint32_t>(temp.failure->fallbacks.size());
+                temp.failure->fallbacks.push_back(&temp);
+            }
+        }
+    }
+
+    /**
+     * @brief updateFailureLinks Updates the failure and output links after a
+     * single keyword was added to a trie whose links were complete. Besides the
+     * new Nodes, only the Nodes that now have one of them as longest suffix and
+     * the Nodes that report the new keyword are visited.
+     * @param terminals The Nodes of the new keyword.
+     * @param firstNew The index of the first Node created for the keyword.
+     */
+    void updateFailureLinks(const std::vector<Node *> &terminals, const std::size_t firstNew)
+    {
+        /* The failure links of shallower Nodes must be known first */
+        std::vector<Node *> added;
+        for (std::size_t idx = firstNew; idx < trieNodes.size(); idx++)
+        {
+            added.push_back(&trieNodes[idx]);
+        }
+        std::stable_sort(added.begin(), added.end(),
+                         [](const Node *lhs, const Node *rhs) { return lhs->depth < rhs->depth; });
+
+        std::vector<Node *> stack;
+        for (Node *current : added)
+        {
+            setFailure(current, findFailure(current));
+
+            /* A Node ending in a suffix of the parent followed by the same
+             * character now fails to the new Node. Below such a Node the
+             * failure tree already has a longer suffix and is left unchanged.
+             */
+            stack = current->parent->fallbacks;
+            while (!stack.empty())
+            {
+                Node *temp = stack.back();
+                stack.pop_back();
+                if (Node *child = getChild(temp, current->c))
+                {
+                    setFailure(child, current);
+                }
+                else
+                {
+                    stack.insert(stack.end(), temp->fallbacks.begin(), temp->fallbacks.end());
+                }
+            }
+        }
+
+        for (Node *current : added)
+        {
+            updateOutputLinks(current);
+        }
+        for (Node *terminal : terminals)
+        {
+            if (terminal->index < firstNew)
+            {
+                updateOutputLinks(terminal);
+            }
+        }
+        addStartBytes();
+    }
+
+    /**
+     * @brief updateOutputLinks Recomputes the output links of a Node and of the
+     * Nodes failing to it. The search does not descend below other keywords,
+     * as the Nodes failing to them keep reporting them.
+     * @param start The pointer to the Node whose subtree of the failure tree is
+     * updated.
+     */
+    void updateOutputLinks(Node *start)
+    {
+        std::vector<Node *> stack{start};
+        while (!stack.empty())
+        {
+            Node *temp = stack.back();
+            stack.pop_back();
+            temp->output = temp->failure->id != -1 ? temp->failure : temp->failure->output;
+            if (temp->id == -1 || temp == start)
+            {
+                stack.insert(stack.end(), temp->fallbacks.begin(), temp->fallbacks.end());
+            }
+        }
+    }
+
+    /**
+     * @brief setFailure Sets the failure link of a Node and moves it to the
+     * fallbacks of its new failure link.
+     * @param current The pointer to the Node.
+     * @param failure The pointer to the new failure link.
+     */
+    static void setFailure(Node *current, Node *failure)
+    {
+        if (current->failSlot != UINT32_MAX)
+        {
+            if (current->failure == failure)
+            {
+                return;
+            }
+            std::vector<Node *> &fallbacks = current->failure->fallbacks;
+            fallbacks[current->failSlot] = fallbacks.back();
+            fallbacks[current->failSlot]->failSlot = current->failSlot;
+            fallbacks.pop_back();
+        }
+        current->failure = failure;
+        current->failSlot = static_cast<std::uint32_t>(failure->fallbacks.size());
+        failure->fallbacks.push_back(current);
+    }
+
+    /**
+     * @brief addStartBytes Collects the characters of the text that lead from
+     * the root to one of its children, after case folding.
+     */
+    void addStartBytes()
+    {
+        startSet.fill(false);
+        for (const Node *child : root->children)
+        {
+            startSet[static_cast<unsigned char>(child->c)] = true;
+        }
+        if (!CaseSensitive)
+        {
+            for (std::size_t character = 0; character < startSet.size(); character++)
+            {
+                const char folded = fold(static_cast<char>(character));
+                startSet[character] =
+                    startSet[character] || startSet[static_cast<unsigned char>(folded)];
+            }
+        }
+        startBytes.clear();
+        for (std::size_t character = 0; character < startSet.size(); character++)
+        {
+            if (startSet[character])
+            {
+                startBytes.push_back(static_cast<char>(character));
+            }
+        }
+    }
+
+    /**
+     * @brief skipToStart Skips the characters of a text that cannot start a
+     * keyword, which is all the root state can do with them. Sets of up to 16
+     * characters are searched 32 (AVX2) or 16 (SSE4.2) characters at a time.
+     * @param text The text to be parsed.
+     * @param pos The position to start at.
+     * @return The position of the next character that can start a keyword or
+     * the size of the text.
+     */
+    std::size_t skipToStart(const std::string_view text, std::size_t pos) const
+    {
+        const char *data = text.data();
+        const std::size_t size = text.size();
+#if defined(__AVX2__)
+        if (startBytes.size() <= 16)
+        {
+            __m256i needles[16];
+            for (std::size_t k = 0; k < startBytes.size(); k++)
+            {
+                needles[k] = _mm256_set1_epi8(startBytes[k]);
+            }
+            for (; size >= 32 && pos <= size - 32; pos += 32)
+            {
+                const __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + pos));
+                __m256i hits = _mm256_setzero_si256();
+                for (std::size_t k = 0; k < startBytes.size(); k++)
+                {
+                    hits = _mm256_or_si256(hits, _mm256_cmpeq_epi8(block, needles[k]));
+                }
+                const std::uint32_t mask = static_cast<std::uint32_t>(_mm256_movemask_epi8(hits));
+                if (mask != 0)
+                {
+                    return pos + trailingZeros(mask);
+                }
+            }
+        }
+#elif defined(__SSE4_2__)
+        if (startBytes.size() <= 16)
+        {
+            char set[16] = {};
+            std::copy(startBytes.begin(), startBytes.end(), set);
+            const __m128i needles = _mm_loadu_si128(reinterpret_cast<const __m128i *>(set));
+            const int count = static_cast<int>(startBytes.size());
+            for (; size >= 16 && pos <= size - 16; pos += 16)
+            {
+                const __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + pos));
+                const int index = _mm_cmpestri(needles, count, block, 16,
+                                               _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ANY |
+                                                   _SIDD_LEAST_SIGNIFICANT);
+                if (index < 16)
+                {
+                    return pos + index;
+                }
+            }
+        }
+#endif
+        while (pos < size && !startSet[static_cast<unsigned char>(data[pos])])
+        {
+            pos++;
+        }
+        return pos;
+    }
+
+    /**
+     * @brief trailingZeros Returns the index of the lowest set bit of a non
+     * zero mask.
+     */
+    static unsigned trailingZeros(const std::uint32_t mask)
+    {
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanForward(&index, mask);
+        return index;
+#else
+        return __builtin_ctz(mask);
+#endif
+    }
+
+    /**
+     * @brief findFailure Follows the failure links of the parent until a Node
+     * with a matching child is found.
+     * @param current The pointer to the Node whose failure link is searched.
+     * @return The pointer to the longest proper suffix of current in the trie.
+     */
+    Node *findFailure(const Node *current) const
+    {
+        Node *temp = current->parent->failure;
+        while (true)
+        {
+            Node *failchild = getChild(temp, current->c);
+            if (failchild != nullptr && failchild != current)
+            {
+                return failchild;
+            }
+            if (temp == root)
+            {
+                return root;
+            }
+            temp = temp->failure;
+        }
+    }
+
+    /**
+     * @brief findChild Searches for a child Node with given character or adds one.
+     * @param current The pointer to the current Node.
+     * @param character The character that is searched.
+     * @param addWord Flag sign to decide whether a new Node should be added.
+     * @return The pointer to the matching Node (possibly after failure links),
+     * root or the newly created one.
+     */
+    const Node *findChild(const Node *current, const char &character) const
+    {
+        if (Node *child = getChild(current, character))
+        {
+            return child;
+        }
+        return traverseFail(current, character);
+    }
+
+    /**
+     * @brief traverseFail Traverse the failure links during a search.
+     * @param current The original Node.
+     * @param character The character that is beeing searched.
+     * @return The pointer to the matching Node after a failure link or root->
+     */
+    const Node *traverseFail(const Node *current, const char &character) const
+    {
+        Node *temp = current->failure;
+        while (temp != root)
+        {
+            if (Node *failchild = getChild(temp, character))
+            {
+                return failchild;
+            }
+            temp = temp->failure;
+        }
+        if (Node *rootchild = getChild(root, character))
+        {
+            return rootchild;
+        }
+        return root;
+    }
+
+    /**
+     * @brief thaw Drops the frozen representation before the trie is modified.
+     */
+    void thaw()
+    {
+        if (image)
+        {
+            throw std::runtime_error("Attempted to modify a loaded keyword trie.");
+        }
+        frozen = Frozen();
+        states.clear();
+        edgeLabels.clear();
+        edgeTargets.clear();
+        edgeSets.clear();
+        transitions.clear();
+        slots.clear();
+        teddy = Teddy();
+    }
+
+    /**
+     * @brief addSlots Builds the double array from the frozen edges. States
+     * are placed breadth first. The children of a state get the first base at
+     * which all of their slots are still free, found by walking a linked list
+     * of the free slots. A free slot that failed as the first child of
+     * maxMisses states is dropped from the list but stays free, so the search
+     * does not keep retrying holes at the front of the array. The array always
+     * extends 256 slots beyond the largest base, so base + character never
+     * needs a bounds check. Afterwards the edge arrays are no longer needed
+     * and released.
+     */
+    void addSlots()
+    {
+        /* Doubly linked circular list of the free slots, with the root as head */
+        std::vector<std::uint32_t> nextFree;
+        std::vector<std::uint32_t> prevFree;
+        /* Failed placements per free slot */
+        std::vector<std::uint8_t> misses;
+        constexpr std::uint8_t maxMisses = 16;
+        const auto grow = [&](const std::size_t size) {
+            if (size > UINT32_MAX)
+            {
+                throw std::length_error("The keyword trie has too many nodes for a double array.");
+            }
+            for (std::size_t slot = slots.size(); slot < size; slot++)
+            {
+                slots.emplace_back();
+                misses.push_back(0);
+                nextFree.push_back(0);
+                prevFree.push_back(prevFree[0]);
+                nextFree[prevFree[0]] = slot;
+                prevFree[0] = slot;
+            }
+        };
+        const auto unlink = [&](const std::uint32_t slot) {
+            nextFree[prevFree[slot]] = nextFree[slot];
+            prevFree[nextFree[slot]] = prevFree[slot];
+        };
+        const auto occupy = [&](const std::uint32_t slot, const std::uint32_t parent) {
+            slots[slot].check = parent;
+            if (misses[slot] < maxMisses)
+            {
+                unlink(slot);
+            }
+        };
+        const auto miss = [&](const std::uint32_t slot) {
+            if (++misses[slot] == maxMisses)
+            {
+                unlink(slot);
+            }
+        };
+
+        slots.assign(1, Slot());
+        slots[0].check = 0;
+        misses.assign(1, 0);
+        nextFree.assign(1, 0);
+        prevFree.assign(1, 0);
+        grow(256 + 1);
+
+        std::vector<std::uint32_t> slotOf(states.size(), 0);
+        std::queue<std::uint32_t> q;
+        q.push(0);
+        while (!q.empty())
+        {
+            const std::uint32_t state = q.front();
+            const State &current = states[state];
+            q.pop();
+            if (current.edgeCount == 0)
+            {
+                continue;
+            }
+            const std::uint32_t lastEdge = current.firstEdge + current.edgeCount;
+            const unsigned char lowest = static_cast<unsigned char>(edgeLabels[current.firstEdge]);
+            std::size_t base = 0;
+            for (std::uint32_t candidate = nextFree[0];; candidate = nextFree[candidate])
+            {
+                if (candidate == 0)
+                {
+                    /* All free slots were tried, continue with new ones */
+                    candidate = slots.size();
+                    grow(slots.size() + 256);
+                }
+                if (candidate <= lowest)
+                {
+                    miss(candidate);
+                    continue;
+                }
+                base = candidate - lowest;
+                grow(base + 256);
+                bool fits = true;
+                for (std::uint32_t edge = current.firstEdge + 1; fits && edge < lastEdge; edge++)
+                {
+                    const unsigned char label = static_cast<unsigned char>(edgeLabels[edge]);
+                    fits = slots[base + label].check == UINT32_MAX;
+                }
+                if (fits)
+                {
+                    break;
+                }
+                miss(candidate);
+            }
+
+            const std::uint32_t slot = slotOf[state];
+            slots[slot].base = static_cast<std::uint32_t>(base);
+            for (std::uint32_t edge = current.firstEdge; edge < lastEdge; edge++)
+            {
+                const std::uint32_t child = base + static_cast<unsigned char>(edgeLabels[edge]);
+                occupy(child, slot);
+                slots[child].state = edgeTargets[edge];
+                slotOf[edgeTargets[edge]] = child;
+                q.push(edgeTargets[edge]);
+            }
+        }
+        for (Slot &slot : slots)
+        {
+            if (slot.check != UINT32_MAX)
+            {
+                slot.failure = slotOf[states[slot.state].failure];
+            }
+        }
+
+        edgeLabels = std::vector<char>();
+        edgeTargets = std::vector<std::uint32_t>();
+        edgeSets = std::vector<LabelSet>();
+    }
+
+    /**
+     * @brief addTeddy Builds the tables of the Teddy engine. Keywords are
+     * sorted by their case folded fingerprint and split into 8 buckets of
+     * consecutive keywords, so that similar keywords share a bucket.
+     */
+    void addTeddy()
+    {
+        teddy = Teddy();
+        if (keywords.empty() || keywords.size() > Teddy::maxKeywords ||
+            std::any_of(keywords.begin(), keywords.end(),
+                        [](const Result &key) { return hasVariants(key.keyword); }))
+        {
+            return;
+        }
+        std::size_t width = Teddy::maxWidth;
+        std::vector<std::uint32_t> order;
+        for (const Result &key : keywords)
+        {
+            std::string pattern = key.keyword;
+            if (!CaseSensitive)
+            {
+                std::transform(pattern.begin(), pattern.end(), pattern.begin(), fold);
+            }
+            if (!isRemoved(key.id))
+            {
+                width = std::min(width, pattern.size());
+                order.push_back(static_cast<std::uint32_t>(key.id));
+            }
+            teddy.patterns.push_back(std::move(pattern));
+        }
+        if (order.empty())
+        {
+            teddy = Teddy();
+            return;
+        }
+
+        std::sort(order.begin(), order.end(), [&](const std::uint32_t lhs, const std::uint32_t rhs) {
+            return teddy.patterns[lhs].compare(0, width, teddy.patterns[rhs], 0, width) < 0;
+        });
+        const std::size_t bucketSize = (order.size() + teddy.buckets.size() - 1) / teddy.buckets.size();
+        for (std::size_t rank = 0; rank < order.size(); rank++)
+        {
+            const std::size_t bucket = rank / bucketSize;
+            const std::string &pattern = teddy.patterns[order[rank]];
+            teddy.buckets[bucket].push_back(order[rank]);
+            for (std::size_t pos = 0; pos < width; pos++)
+            {
+                /* Every character of the text that folds onto the pattern character */
+                for (std::size_t character = 0; character < 256; character++)
+                {
+                    const char raw = static_cast<char>(character);
+                    if (fold(raw) == pattern[pos])
+                    {
+                        teddy.low[pos][character & 0xF] |= 1 << bucket;
+                        teddy.high[pos][character >> 4] |= 1 << bucket;
+                    }
+                }
+            }
+        }
+        teddy.width = width;
+    }
+
+    /**
+     * @brief teddyBuckets Scalar computation of the candidate buckets of a
+     * position of the text.
+     */
+    std::uint8_t teddyBuckets(const char *data) const
+    {
+        std::uint8_t candidates = 0xFF;
+        for (std::size_t pos = 0; pos < teddy.width; pos++)
+        {
+            const unsigned char character = static_cast<unsigned char>(data[pos]);
+            candidates &= teddy.low[pos][character & 0xF] & teddy.high[pos][character >> 4];
+        }
+        return candidates;
+    }
+
+    /**
+     * @brief parseTeddy Parses a complete text with the Teddy engine.
+     * Candidates are found in order of their start position, so confirmed
+     * matches are held back until no later match can end before them. This
+     * reports them ordered by end position and longest first, just like the
+     * output links of the automaton.
+     * @param text The text to be parsed.
+     * @param report Called with the keyword index, end position and length of
+     * a match, returns false to stop the search.
+     * @return Returns false if the search was stopped, true otherwise.
+     */
+    template <typename Report>
+    bool parseTeddy(const std::string_view text, Report &report) const
+    {
+        /* End position, inverted length and keyword index of a confirmed match */
+        using Pending = std::tuple<std::size_t, std::size_t, std::size_t>;
+        std::priority_queue<Pending, std::vector<Pending>, std::greater<Pending>> pending;
+        const auto flush = [&](const std::size_t pos) {
+            while (!pending.empty() && std::get<0>(pending.top()) < pos)
+            {
+                const std::size_t end = std::get<0>(pending.top());
+                const std::size_t length = SIZE_MAX - std::get<1>(pending.top());
+                const std::size_t id = std::get<2>(pending.top());
+                pending.pop();
+                if (!report(id, end, length))
+                {
+                    return false;
+                }
+            }
+            return true;
+        };
+        const auto confirm = [&](const std::size_t pos, std::uint8_t candidates) {
+            if (!flush(pos))
+            {
+                return false;
+            }
+            while (candidates != 0)
+            {
+                const unsigned bucket = trailingZeros(candidates);
+                candidates &= candidates - 1;
+                for (const std::uint32_t id : teddy.buckets[bucket])
+                {
+                    const std::string &pattern = teddy.patterns[id];
+                    if (pos + pattern.size() <= text.size() && matchesAt(text, pos, pattern))
+                    {
+                        pending.emplace(pos + pattern.size() - 1, SIZE_MAX - pattern.size(), id);
+                    }
+                }
+            }
+            return true;
+        };
 
-        explicit Node() = default;
-        explicit Node(const int d, const char character, Node *par, Node *root)
-            : depth(d), c(character), parent(par), failure(root), output(root)
+        const char *data = text.data();
+        std::size_t pos = 0;
+#if defined(__AVX2__) || defined(__SSSE3__)
+#if defined(__AVX2__)
+        using Block = __m256i;
+        const auto broadcast = [](const std::array<std::uint8_t, 16> &table) {
+            return _mm256_broadcastsi128_si256(
+                _mm_loadu_si128(reinterpret_cast<const __m128i *>(table.data())));
+        };
+        const auto fingerprint = [](const Block low, const Block high, const char *block) {
+            const Block characters = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(block));
+            const Block nibble = _mm256_set1_epi8(0xF);
+            return _mm256_and_si256(
+                _mm256_shuffle_epi8(low, _mm256_and_si256(characters, nibble)),
+                _mm256_shuffle_epi8(high, _mm256_and_si256(_mm256_srli_epi16(characters, 4), nibble)));
+        };
+        const auto combine = [](const Block lhs, const Block rhs) { return _mm256_and_si256(lhs, rhs); };
+        const auto nonZero = [](const Block block) {
+            return ~static_cast<std::uint32_t>(
+                _mm256_movemask_epi8(_mm256_cmpeq_epi8(block, _mm256_setzero_si256())));
+        };
+        const auto store = [](std::uint8_t *target, const Block block) {
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(target), block);
+        };
+        const Block all = _mm256_set1_epi8(-1);
+#else
+        using Block = __m128i;
+        const auto broadcast = [](const std::array<std::uint8_t, 16> &table) {
+            return _mm_loadu_si128(reinterpret_cast<const __m128i *>(table.data()));
+        };
+        const auto fingerprint = [](const Block low, const Block high, const char *block) {
+            const Block characters = _mm_loadu_si128(reinterpret_cast<const __m128i *>(block));
+            const Block nibble = _mm_set1_epi8(0xF);
+            return _mm_and_si128(
+                _mm_shuffle_epi8(low, _mm_and_si128(characters, nibble)),
+                _mm_shuffle_epi8(high, _mm_and_si128(_mm_srli_epi16(characters, 4), nibble)));
+        };
+        const auto combine = [](const Block lhs, const Block rhs) { return _mm_and_si128(lhs, rhs); };
+        const auto nonZero = [](const Block block) {
+            return ~static_cast<std::uint32_t>(
+                       _mm_movemask_epi8(_mm_cmpeq_epi8(block, _mm_setzero_si128()))) &
+                   0xFFFF;
+        };
+        const auto store = [](std::uint8_t *target, const Block block) {
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(target), block);
+        };
+        const Block all = _mm_set1_epi8(-1);
+#endif
+        constexpr std::size_t blockSize = sizeof(Block);
+        Block low[Teddy::maxWidth];
+        Block high[Teddy::maxWidth];
+        for (std::size_t k = 0; k < teddy.width; k++)
         {
+            low[k] = broadcast(teddy.low[k]);
+            high[k] = broadcast(teddy.high[k]);
         }
-    };
+        /* Characters read by one block at most, compared without overflow on short texts */
+        constexpr std::size_t blockSpan = blockSize + Teddy::maxWidth - 1;
+        for (; text.size() >= blockSpan && pos <= text.size() - blockSpan; pos += blockSize)
+        {
+            Block candidates = all;
+            for (std::size_t k = 0; k < teddy.width; k++)
+            {
+                candidates = combine(candidates, fingerprint(low[k], high[k], data + pos + k));
+            }
+            std::uint32_t mask = nonZero(candidates);
+            if (mask == 0)
+            {
+                continue;
+            }
+            std::uint8_t buckets[blockSize];
+            store(buckets, candidates);
+            while (mask != 0)
+            {
+                const unsigned offset = trailingZeros(mask);
+                mask &= mask - 1;
+                if (!confirm(pos + offset, buckets[offset]))
+                {
+                    return false;
+                }
+            }
+        }
+#endif
+        for (; pos + teddy.width <= text.size(); pos++)
+        {
+            const std::uint8_t candidates = teddyBuckets(data + pos);
+            if (candidates != 0 && !confirm(pos, candidates))
+            {
+                return false;
+            }
+        }
+        return flush(SIZE_MAX);
+    }
 
-    Node *root;                                   /**< The root Node */
-    std::vector<std::unique_ptr<Node>> trieNodes; /**< Container of the Node pointers */
-    std::vector<Result> keywords;                 /**< Container of the Result stubs */
-  public:
     /**
-     * @brief trie Initializes the trie structure with its root Node.
+     * @brief matchesAt Compares a case folded keyword with the text.
      */
-    keyword_trie()
+    static bool matchesAt(const std::string_view text, const std::size_t pos, const std::string &pattern)
     {
-        trieNodes.emplace_back(std::make_unique<Node>());
-        root = trieNodes.front().get();
-        root->parent = root;
-        root->failure = root;
-        root->output = root;
+        for (std::size_t k = 0; k < pattern.size(); k++)
+        {
+            const char character = text[pos + k];
+            if (fold(character) != pattern[k])
+            {
+                return false;
+            }
+        }
+        return true;
     }
 
     /**
-     * @brief addString Insert a new keyword into the keyword trie.
-     * @param key The new keyword to be inserted.
-     * @param addFailure Flag to signal whether the failure links should
-     * immediately be updated.
+     * @brief addByteClasses Partitions the characters into equivalence classes.
+     * Characters that do not occur in any keyword behave identically in every
+     * state and share one class, every other character gets its own class.
+     * Without case sensitivity both cases of a letter share the class of the
+     * lower case, so the dense table needs no case folding of the text.
      */
-    void addString(const std::string &key, const bool addFailure = true)
+    void addByteClasses()
     {
-        if (key.empty())
+        std::array<bool, 256> used{};
+        for (const char label : edgeLabels)
         {
-            return;
+            used[static_cast<unsigned char>(label)] = true;
         }
-        Node *current = root;
-        for (const char character : key)
+        const bool hasUnused = std::find(used.begin(), used.end(), false) != used.end();
+        classCount = hasUnused ? 1 : 0;
+        for (std::size_t character = 0; character < used.size(); character++)
         {
-            current = addChild(current, CaseSensitive ? character : std::tolower(character));
+            byteClasses[character] = used[character] ? classCount++ : 0;
         }
-        if (current->id != -1)
+        if (!CaseSensitive)
         {
-            throw std::runtime_error(
-                "Attempted to add two identical strings to the keyword tree.");
+            for (std::size_t character = 0; character < byteClasses.size(); character++)
+            {
+                byteClasses[character] =
+                    byteClasses[static_cast<unsigned char>(fold(static_cast<char>(character)))];
+            }
         }
-        current->id = keywords.size();
-        keywords.emplace_back(key, keywords.size());
+    }
 
-        if (addFailure)
+    /**
+     * @brief addTransitions Resolves all failure links of the frozen states
+     * into a complete transition table with one column per byte class. States
+     * are processed breadth first, so the row of the failure state is always
+     * finished before it is copied.
+     */
+    void addTransitions()
+    {
+        addByteClasses();
+        transitions.assign(states.size() * classCount, 0);
+        std::queue<std::uint32_t> q;
+        q.push(0);
+        while (!q.empty())
         {
-            addFailureLinks();
+            const std::uint32_t state = q.front();
+            const State &current = states[state];
+            std::uint32_t *row = transitions.data() + static_cast<std::size_t>(state) * classCount;
+            if (state != 0)
+            {
+                const std::uint32_t *failRow =
+                    transitions.data() + static_cast<std::size_t>(current.failure) * classCount;
+                std::copy(failRow, failRow + classCount, row);
+            }
+            const std::uint32_t lastEdge = current.firstEdge + current.edgeCount;
+            for (std::uint32_t edge = current.firstEdge; edge < lastEdge; edge++)
+            {
+                row[byteClasses[static_cast<unsigned char>(edgeLabels[edge])]] = edgeTargets[edge];
+                q.push(edgeTargets[edge]);
+            }
+            q.pop();
         }
     }
 
     /**
-     * @brief addString Wrapper around addString(std::string, bool) to add a
-     * set of strings.
-     * @param keyList The set containing the keys.
+     * @brief withLayout Calls a function with the transition function of the
+     * frozen layout and the mapping from positions of the layout to frozen
+     * states.
+     * @param function Called with the transition function and the mapping.
+     * @return Returns the result of the function.
      */
-    void addString(const std::set<std::string> &keyList)
+    template <typename Function>
+    auto withLayout(Function function) const
     {
-        for (const std::string &key : keyList)
+        const auto identity = [](const std::uint32_t current) { return current; };
+        switch (layout)
         {
-            addString(key, false);
+        case Layout::Dense:
+            return function(
+                [this](const std::uint32_t current, const char character) {
+                    return findTransition(current, character);
+                },
+                identity);
+        case Layout::DoubleArray:
+            return function(
+                [this](const std::uint32_t current, const char character) {
+                    return findSlot(current, fold(character));
+                },
+                [this](const std::uint32_t current) { return frozen.slots[current].state; });
+        default:
+            return function(
+                [this](const std::uint32_t current, const char character) {
+                    return findState(current, fold(character));
+                },
+                identity);
         }
-        addFailureLinks();
     }
 
     /**
-     * @brief addString Wrapper around addString(std::string, bool) to add a
-     * vector of strings.
-     * @param keyList The vector containing the keys.
+     * @brief firstKeyword Returns the index of the longest keyword of the
+     * first match to end in a text, -1 if there is none.
+     * @param text The text to be parsed.
      */
-    void addString(const std::vector<std::string> &keyList)
+    std::int64_t firstKeyword(const std::string_view text) const
     {
-        for (const std::string &key : keyList)
+        if (teddy.width != 0)
         {
-            addString(key, false);
+            std::int64_t found = -1;
+            auto report = [&](const std::size_t id, const std::size_t, const std::size_t) {
+                found = static_cast<std::int64_t>(id);
+                return false;
+            };
+            parseTeddy(text, report);
+            return found;
         }
-        addFailureLinks();
+        if (isFrozen())
+        {
+            return withLayout([&](const auto next, const auto stateOf) {
+                return findAccepting(text, next, [&](const std::uint32_t current) -> std::int64_t {
+                    const State &state = frozen.states[stateOf(current)];
+                    if (state.id != -1 || state.output == 0)
+                    {
+                        return state.id;
+                    }
+                    return frozen.states[state.output].id;
+                });
+            });
+        }
+        return findAccepting(
+            text,
+            [this](const std::uint32_t current, const char character) {
+                return findChild(&trieNodes[current], fold(character))->index;
+            },
+            [this](const std::uint32_t current) -> std::int64_t {
+                const Node &node = trieNodes[current];
+                return node.id != -1 ? node.id : node.output->id;
+            });
     }
 
     /**
-     * @brief parseText Parses a text with the trie.
+     * @brief findAccepting Runs the automaton over a text until it reaches a
+     * state in which a keyword ends.
      * @param text The text to be parsed.
-     * @return Returns a vector with all matches.
+     * @param next The transition function.
+     * @param keywordOf Returns the index of the longest keyword ending in a
+     * state, -1 if there is none.
+     * @return Returns the index of the keyword, -1 if no state was accepting.
      */
-    std::vector<Result> parseText(const std::string &text) const
+    template <typename Transition, typename KeywordOf>
+    std::int64_t findAccepting(const std::string_view text, Transition next, KeywordOf keywordOf) const
     {
-        std::vector<Result> Results;
-        if (text.empty())
-        {
-            return Results;
-        }
-        Node *current = root;
-        for (size_t i = 0; i < text.size(); i++)
+        std::uint32_t current = 0;
+        for (std::size_t i = 0; i < text.size(); i++)
         {
-            current = findChild(current, CaseSensitive ? text.at(i)
-                                                       : std::tolower(text.at(i)));
-            if (current->id != -1)
+            if (current == 0)
             {
-                Results.emplace_back(keywords.at(current->id), i);
+                i = skipToStart(text, i);
+                if (i == text.size())
+                {
+                    break;
+                }
             }
-            /* Process the output links for possible additional matches */
-            Node *temp = current->output;
-            while (temp != root)
+            current = next(current, text[i]);
+            const std::int64_t found = keywordOf(current);
+            if (found != -1)
             {
-                Results.emplace_back(keywords.at(temp->id), i);
-                temp = temp->output;
+                return found;
             }
         }
-        return Results;
+        return -1;
     }
 
-  private:
     /**
-     * @brief addChild Add a child Node to the trie.
-     * @param parrent The pointer to the parrent Node of the new one.
-     * @param character The character on the edge to the new Node.
-     * @return The pointer to the newly created Node.
+     * @brief countVisits Runs the automaton over a text and counts how often
+     * every position of the layout is reached.
+     * @param text The text to be parsed.
+     * @param visits The counts, indexed by position of the layout.
+     * @param next The transition function.
      */
-    Node *addChild(Node *current, const char &character)
+    template <typename Transition>
+    void countVisits(const std::string_view text, std::vector<std::uint64_t> &visits, Transition next) const
     {
-        for (Node *child : current->children)
+        std::uint32_t current = 0;
+        for (std::size_t i = 0; i < text.size(); i++)
         {
-            if (child->c == character)
+            if (current == 0)
             {
-                return child;
+                i = skipToStart(text, i);
+                if (i == text.size())
+                {
+                    break;
+                }
             }
+            current = next(current, text[i]);
+            visits[current]++;
         }
-        trieNodes.emplace_back(std::make_unique<Node>(current->depth + 1,
-                                                      character,
-                                                      current,
-                                                      root));
-        current->children.emplace_back(trieNodes.back().get());
-        return trieNodes.back().get();
     }
 
     /**
-     * @brief addFailureLinks Utilize a breadth first search to generate the
-     * failure links.
+     * @brief The Candidate struct describing a match of the leftmost walk that
+     * is held back until no earlier or better match can still be found.
      */
-    void addFailureLinks()
+    struct Candidate
     {
-        std::queue<Node *> q;
-        q.push(root);
-        while (!q.empty())
+        std::size_t id;     /**< Keyword index */
+        std::size_t start;  /**< The starting position of the match */
+        std::size_t length; /**< Length of the keyword */
+    };
+
+    /**
+     * @brief The Entry struct describing a state for the leftmost walk.
+     */
+    struct Entry
+    {
+        std::int64_t id;      /**< Keyword index, -1 if no keyword ends here */
+        std::size_t depth;    /**< Depth of the state */
+        std::uint32_t output; /**< Output link */
+    };
+
+    /**
+     * @brief parseLeftmost Parses a complete text and reports the
+     * non-overlapping matches of the selected leftmost match kind.
+     * @param text The text to be parsed.
+     * @param report Called with the keyword index, end position and length of
+     * a match, returns false to stop the search.
+     * @return Returns false if the search was stopped, true otherwise.
+     */
+    template <typename Report>
+    bool parseLeftmost(const std::string_view text, Report &report) const
+    {
+        if (isFrozen())
         {
-            Node *temp = q.front();
-            for (Node *child : temp->children)
+            return withLayout([&](const auto next, const auto stateOf) {
+                return walkLeftmost(
+                    text, report, next, stateOf,
+                    [this](const std::uint32_t state) {
+                        const State &found = frozen.states[state];
+                        return Entry{found.id, found.depth, found.output};
+                    },
+                    [this](const std::uint32_t current) {
+                        return layout == Layout::DoubleArray ? frozen.slots[current].failure
+                                                             : frozen.states[current].failure;
+                    });
+            });
+        }
+        return walkLeftmost(
+            text, report,
+            [this](const std::uint32_t current, const char character) {
+                return findChild(&trieNodes[current], fold(character))->index;
+            },
+            [](const std::uint32_t current) { return current; },
+            [this](const std::uint32_t state) {
+                const Node &node = trieNodes[state];
+                return Entry{node.id, static_cast<std::size_t>(node.depth), node.output->index};
+            },
+            [this](const std::uint32_t current) { return trieNodes[current].failure->index; });
+    }
+
+    /**
+     * @brief walkLeftmost Runs the automaton over a text without ever going
+     * back. After every reported match the state is cut back along its failure
+     * links to the longest suffix starting behind it. The matches that could
+     * follow the earliest pending one are kept as a list of non-overlapping
+     * candidates in the order the leftmost search would pick them. A new match
+     * replaces the candidate it beats and everything behind it, and the first
+     * candidate is reported once the state starts behind it.
+     * @param text The text to be parsed.
+     * @param report Called with the keyword index, end position and length of
+     * a match, returns false to stop the search.
+     * @param next The transition function.
+     * @param stateOf Maps a position of the automaton to its state.
+     * @param entry Returns the Entry of a state.
+     * @param failure Returns the failure link of a position of the automaton.
+     * @return Returns false if the search was stopped, true otherwise.
+     */
+    template <typename Report, typename Transition, typename StateOf, typename Lookup, typename Failure>
+    bool walkLeftmost(const std::string_view text, Report &report, Transition next, StateOf stateOf,
+                      Lookup entry, Failure failure) const
+    {
+        const bool first = matchKind == MatchKind::LeftmostFirst;
+        std::vector<Candidate> pending;
+        std::size_t head = 0;  /* The first candidate that is not reported yet */
+        std::size_t floor = 0; /* The end of the last reported match plus one */
+        const auto flush = [&](const std::size_t reach) {
+            while (head < pending.size() && pending[head].start < reach)
             {
-                q.push(child);
+                const Candidate &found = pending[head++];
+                if (!report(found.id, found.start + found.length - 1, found.length))
+                {
+                    return false;
+                }
+                floor = found.start + found.length;
             }
-            /* A failure link with just one less charater is the optimum and will
-             * never change.
+            if (head == pending.size())
+            {
+                pending.clear();
+                head = 0;
+            }
+            else if (head >= 64 && 2 * head >= pending.size())
+            {
+                pending.erase(pending.begin(), pending.begin() + head);
+                head = 0;
+            }
+            return true;
+        };
+
+        std::uint32_t current = 0;
+        for (std::size_t i = 0; i < text.size(); i++)
+        {
+            if (current == 0)
+            {
+                i = skipToStart(text, i);
+                if (i == text.size())
+                {
+                    break;
+                }
+            }
+            current = next(current, text[i]);
+            std::size_t depth = entry(stateOf(current)).depth;
+            while (true)
+            {
+                /* Matches may not start inside a reported one */
+                while (i + 1 - depth < floor)
+                {
+                    current = failure(current);
+                    depth = entry(stateOf(current)).depth;
+                }
+                const std::size_t reported = floor;
+                if (!flush(i + 1 - depth))
+                {
+                    return false;
+                }
+                if (floor == reported)
+                {
+                    break;
+                }
+            }
+
+            /* Place the longest keyword ending here that is not beaten. Shorter
+             * keywords start later, so the candidate they overlap only moves on.
              */
-            if (temp->failure->depth < temp->depth - 1)
+            const Entry found = entry(stateOf(current));
+            auto behind = pending.end();
+            for (std::uint32_t state = found.id != -1 ? stateOf(current) : found.output; state != 0;)
             {
-                for (Node *failchild : temp->parent->failure->children)
+                const Entry keyword = entry(state);
+                const std::size_t start = i + 1 - keyword.depth;
+                const auto overlaps = [start](const Candidate &candidate) {
+                    return candidate.start + candidate.length > start;
+                };
+                if (head == pending.size() || !overlaps(pending.back()))
+                {
+                    behind = pending.end();
+                }
+                else if (behind == pending.end())
                 {
-                    if (failchild->c == temp->c)
+                    behind = std::partition_point(pending.begin() + head, pending.end(),
+                                                  [&](const Candidate &candidate) { return !overlaps(candidate); });
+                }
+                else
+                {
+                    while (!overlaps(*behind))
                     {
-                        temp->failure = failchild;
+                        behind++;
                     }
                 }
+                if (behind == pending.end() || start < behind->start ||
+                    (start == behind->start && (!first || static_cast<std::size_t>(keyword.id) < behind->id)))
+                {
+                    pending.erase(behind, pending.end());
+                    pending.push_back(Candidate{static_cast<std::size_t>(keyword.id), start, keyword.depth});
+                    break;
+                }
+                state = keyword.output;
             }
+        }
+        return flush(SIZE_MAX);
+    }
 
-            /* Process the failure links for possible additional matches */
-            Node *out = temp->failure;
-            while (out != root)
+    /**
+     * @brief parseStates Runs the frozen automaton over a text.
+     * @param text The text to be parsed.
+     * @param state The state to start in, updated to the state after the last
+     * parsed character.
+     * @param offset The absolute position of the first character of text.
+     * @param report Called with the keyword index, absolute end position and
+     * length of a match, returns false to stop the search.
+     * @param next The transition function of the frozen layout.
+     * @param stateOf Maps a position of the layout to its frozen state.
+     * @return Returns false if the search was stopped, true otherwise.
+     */
+    template <typename Report, typename Transition, typename StateOf>
+    bool parseStates(const std::string_view text, std::uint32_t &state, const std::size_t offset,
+                     Report &report, Transition next, StateOf stateOf) const
+    {
+        std::uint32_t current = state;
+        for (size_t i = 0; i < text.size(); i++)
+        {
+            if (current == 0)
             {
-                if (out->id != -1)
+                i = skipToStart(text, i);
+                if (i == text.size())
                 {
                     break;
                 }
-                out = out->failure;
             }
-            temp->output = out;
-            q.pop();
+            current = next(current, text[i]);
+            const State &found = frozen.states[stateOf(current)];
+            if (found.id != -1 && !report(found.id, offset + i, found.depth))
+            {
+                state = current;
+                return false;
+            }
+            /* Process the output links for possible additional matches */
+            std::uint32_t temp = found.output;
+            while (temp != 0)
+            {
+                if (!report(frozen.states[temp].id, offset + i, frozen.states[temp].depth))
+                {
+                    state = current;
+                    return false;
+                }
+                temp = frozen.states[temp].output;
+            }
         }
+        state = current;
+        return true;
     }
 
     /**
-     * @brief findChild Searches for a child Node with given character or adds one.
-     * @param current The pointer to the current Node.
+     * @brief findTransition Looks up the dense transition table.
+     * @param state The index of the current state.
      * @param character The character that is searched.
-     * @param addWord Flag sign to decide whether a new Node should be added.
-     * @return The pointer to the matching Node (possibly after failure links),
-     * root or the newly created one.
+     * @return The index of the next state.
      */
-    Node *findChild(Node *current, const char &character) const
+    std::uint32_t findTransition(const std::uint32_t state, const char character) const
     {
-        for (Node *child : current->children)
+        return frozen.transitions[static_cast<std::size_t>(state) * classCount +
+                           byteClasses[static_cast<unsigned char>(character)]];
+    }
+
+    /**
+     * @brief findSlot Double array counterpart of findState.
+     * @param slot The slot of the current state.
+     * @param character The character that is searched.
+     * @return The slot of the matching state (possibly after failure links) or
+     * 0 for the root.
+     */
+    std::uint32_t findSlot(std::uint32_t slot, const char character) const
+    {
+        while (true)
         {
-            if (child->c == character)
+            const std::uint32_t next = frozen.slots[slot].base + static_cast<unsigned char>(character);
+            if (frozen.slots[next].check == slot)
+            {
+                return next;
+            }
+            if (slot == 0)
             {
-                return child;
+                return 0;
             }
+            slot = frozen.slots[slot].failure;
         }
-        return traverseFail(current, character);
     }
 
     /**
-     * @brief traverseFail Traverse the failure links during a search.
-     * @param current The original Node.
-     * @param character The character that is beeing searched.
-     * @return The pointer to the matching Node after a failure link or root->
+     * @brief findEdge Searches the frozen edges of a state for a character.
+     * @param state The index of the state.
+     * @param character The character that is searched.
+     * @return The index of the child state or 0 if there is none.
      */
-    Node *traverseFail(Node *current, const char &character) const
+    std::uint32_t findEdge(const std::uint32_t state, const char character) const
     {
-        Node *temp = current->failure;
-        while (temp != root)
+        const State &current = frozen.states[state];
+        if (current.edgeCount > maxScannedEdges)
         {
-            for (Node *failchild : temp->children)
+            const LabelSet &labels = frozen.edgeSets[current.labels];
+            if (!labels.contains(character))
             {
-                if (failchild->c == character)
-                {
-                    return failchild;
-                }
+                return 0;
             }
-            temp = temp->failure;
+            return frozen.edgeTargets[current.firstEdge + labels.rank(character)];
         }
-        for (Node *rootchild : root->children)
+        const std::uint32_t lastEdge = current.firstEdge + current.edgeCount;
+        for (std::uint32_t edge = current.firstEdge; edge < lastEdge; edge++)
         {
-            if (rootchild->c == character)
+            if (frozen.edgeLabels[edge] == character)
             {
-                return rootchild;
+                return frozen.edgeTargets[edge];
             }
         }
-        return root;
+        return 0;
+    }
+
+    /**
+     * @brief findState Frozen counterpart of findChild and traverseFail.
+     * @param state The index of the current state.
+     * @param character The character that is searched.
+     * @return The index of the matching state (possibly after failure links) or
+     * 0 for the root.
+     */
+    std::uint32_t findState(std::uint32_t state, const char character) const
+    {
+        while (true)
+        {
+            const std::uint32_t next = findEdge(state, character);
+            if (next != 0 || state == 0)
+            {
+                return next;
+            }
+            state = frozen.states[state].failure;
+        }
     }
 }; // class keyword_trie
 
+/**
+ * @brief The shared_keyword_trie class publishing immutable snapshots of a
+ * keyword trie to concurrent readers. Readers acquire the current snapshot
+ * without blocking and keep it alive as long as they use it. A writer builds
+ * the next trie on its own and publishes it with one atomic pointer swap. The
+ * previous snapshot is released once no reader can still be acquiring it, in
+ * the manner of RCU, and destroyed when its last reader lets go.
+ */
+template <bool CaseSensitive = true>
+class shared_keyword_trie
+{
+  public:
+    /** A reference counted immutable trie */
+    using snapshot = std::shared_ptr<const keyword_trie<CaseSensitive>>;
+
+    /**
+     * @brief shared_keyword_trie Starts with a trie, by default an empty one.
+     * @param trie The first snapshot.
+     */
+    explicit shared_keyword_trie(keyword_trie<CaseSensitive> &&trie = keyword_trie<CaseSensitive>())
+        : current(new snapshot(std::make_shared<const keyword_trie<CaseSensitive>>(std::move(trie))))
+    {
+    }
+
+    shared_keyword_trie(const shared_keyword_trie &) = delete;
+    shared_keyword_trie &operator=(const shared_keyword_trie &) = delete;
+    ~shared_keyword_trie() { delete current.load(); }
+
+    /**
+     * @brief acquire Returns the current snapshot. Never blocks, searches on
+     * the snapshot are unaffected by later calls of replace.
+     */
+    snapshot acquire() const
+    {
+        Stripe &stripe = stripes[stripeIndex()];
+        const std::size_t parity = epoch.load() & 1;
+        stripe.readers[parity].fetch_add(1);
+        snapshot result = *current.load();
+        stripe.readers[parity].fetch_sub(1);
+        return result;
+    }
+
+    /**
+     * @brief replace Publishes a new trie. Readers that acquire a snapshot
+     * afterwards see the new trie. Returns once no reader can still be
+     * acquiring the previous snapshot. Concurrent writers are serialized.
+     * @param trie The next trie, best frozen before it is published.
+     */
+    void replace(keyword_trie<CaseSensitive> &&trie)
+    {
+        snapshot *next = new snapshot(std::make_shared<const keyword_trie<CaseSensitive>>(std::move(trie)));
+        const std::lock_guard<std::mutex> lock(writer);
+        snapshot *previous = current.exchange(next);
+
+        /* Readers that might have loaded the previous pointer are counted in
+         * one of the two parities. New readers use the other parity after
+         * each flip, so both drain.
+         */
+        for (int flip = 0; flip < 2; flip++)
+        {
+            const std::size_t parity = epoch.fetch_add(1) & 1;
+            for (const Stripe &stripe : stripes)
+            {
+                while (stripe.readers[parity].load() != 0)
+                {
+                    std::this_thread::yield();
+                }
+            }
+        }
+        delete previous;
+    }
+
+  private:
+    /**
+     * @brief The Stripe struct counting the readers of a group of threads
+     * that are acquiring a snapshot, on its own cache line.
+     */
+    struct alignas(64) Stripe
+    {
+        std::array<std::atomic<std::size_t>, 2> readers{}; /**< Readers by parity of the epoch */
+    };
+
+    static constexpr std::size_t stripeCount = 16; /**< Number of reader stripes */
+
+    /**
+     * @brief stripeIndex Returns the stripe of the calling thread.
+     */
+    static std::size_t stripeIndex()
+    {
+        static std::atomic<std::size_t> nextIndex{0};
+        thread_local const std::size_t index = nextIndex.fetch_add(1) % stripeCount;
+        return index;
+    }
+
+    std::atomic<snapshot *> current;                  /**< The published snapshot */
+    std::atomic<std::size_t> epoch{0};                /**< Selects the parity of new readers */
+    mutable std::array<Stripe, stripeCount> stripes;  /**< Readers acquiring a snapshot */
+    std::mutex writer;                                /**< Serializes replace */
+}; // class shared_keyword_trie
+
 } // namespace miscco
 #endif // MISCCO_KEYWORDTRIE_HPP
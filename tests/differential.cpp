@@ -0,0 +1,303 @@
+/**
+ * Differential test of the keyword trie. Random keyword sets are searched in
+ * random texts with every layout, engine and match kind, and the matches are
+ * compared with those of a naive scanner. A second part replaces the trie of a
+ * shared_keyword_trie while other threads keep searching it.
+ *
+ * Build and run it from the root of the repository, once for every instruction
+ * set that has its own search loops:
+ *
+ *     g++ -std=c++17 -O2 -pthread -I. tests/differential.cpp -o differential && ./differential
+ *     g++ -std=c++17 -O2 -pthread -mssse3 -I. tests/differential.cpp -o differential && ./differential
+ *     g++ -std=c++17 -O2 -pthread -msse4.2 -I. tests/differential.cpp -o differential && ./differential
+ *     g++ -std=c++17 -O2 -pthread -mavx2 -I. tests/differential.cpp -o differential && ./differential
+ */
+#include "keywordTrie.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+namespace
+{
+/** A match as (id, start, end), comparable across both scanners */
+using Found = std::tuple<std::size_t, std::size_t, std::size_t>;
+
+template <bool CaseSensitive>
+using Trie = miscco::keyword_trie<CaseSensitive>;
+
+std::mt19937 generator(20240601);
+std::size_t failures = 0;
+
+/**
+ * @brief randomString Returns a string of random characters of an alphabet.
+ */
+std::string randomString(const std::string &alphabet, const std::size_t length)
+{
+    std::uniform_int_distribution<std::size_t> pick(0, alphabet.size() - 1);
+    std::string result;
+    for (std::size_t pos = 0; pos < length; pos++)
+    {
+        result += alphabet[pick(generator)];
+    }
+    return result;
+}
+
+/**
+ * @brief lower Folds the ASCII letters of a string to lower case.
+ */
+std::string lower(std::string text)
+{
+    for (char &character : text)
+    {
+        if (character >= 'A' && character <= 'Z')
+        {
+            character = static_cast<char>(character - 'A' + 'a');
+        }
+    }
+    return text;
+}
+
+/**
+ * @brief naiveMatches Compares every keyword at every position of the text.
+ * All matches are ordered by their end and then by their start, the leftmost
+ * kinds pick one match at the leftmost start and resume behind it.
+ */
+template <bool CaseSensitive>
+std::vector<Found> naiveMatches(const std::vector<std::string> &keys, const std::string &text,
+                                const typename Trie<CaseSensitive>::MatchKind kind)
+{
+    using MatchKind = typename Trie<CaseSensitive>::MatchKind;
+    const std::string haystack = CaseSensitive ? text : lower(text);
+    std::vector<std::string> needles;
+    for (const std::string &key : keys)
+    {
+        needles.push_back(CaseSensitive ? key : lower(key));
+    }
+    const auto matchesAt = [&](const std::size_t id, const std::size_t start) {
+        return haystack.compare(start, needles[id].size(), needles[id]) == 0;
+    };
+
+    std::vector<Found> result;
+    if (kind == MatchKind::All)
+    {
+        for (std::size_t start = 0; start < haystack.size(); start++)
+        {
+            for (std::size_t id = 0; id < keys.size(); id++)
+            {
+                if (matchesAt(id, start))
+                {
+                    result.emplace_back(id, start, start + keys[id].size() - 1);
+                }
+            }
+        }
+        std::sort(result.begin(), result.end(), [](const Found &lhs, const Found &rhs) {
+            return std::make_pair(std::get<2>(lhs), std::get<1>(lhs)) <
+                   std::make_pair(std::get<2>(rhs), std::get<1>(rhs));
+        });
+        return result;
+    }
+    for (std::size_t start = 0; start < haystack.size();)
+    {
+        std::size_t best = keys.size();
+        for (std::size_t id = 0; id < keys.size(); id++)
+        {
+            if (matchesAt(id, start) &&
+                (best == keys.size() ||
+                 (kind == MatchKind::LeftmostLongest && keys[id].size() > keys[best].size())))
+            {
+                best = id;
+            }
+        }
+        if (best == keys.size())
+        {
+            start++;
+            continue;
+        }
+        result.emplace_back(best, start, start + keys[best].size() - 1);
+        start += keys[best].size();
+    }
+    return result;
+}
+
+/**
+ * @brief trieMatches Searches a text with parseMatches.
+ */
+template <bool CaseSensitive>
+std::vector<Found> trieMatches(const Trie<CaseSensitive> &trie, const std::string &text)
+{
+    std::vector<Found> result;
+    for (const auto &match : trie.parseMatches(text))
+    {
+        result.emplace_back(match.id, match.start, match.end);
+    }
+    return result;
+}
+
+/**
+ * @brief randomKeys Returns distinct random keywords, compared after case
+ * folding unless the trie is case sensitive.
+ */
+template <bool CaseSensitive>
+std::vector<std::string> randomKeys(const std::string &alphabet, const std::size_t count)
+{
+    std::uniform_int_distribution<std::size_t> length(1, 6);
+    std::set<std::string> seen;
+    std::vector<std::string> keys;
+    while (keys.size() < count)
+    {
+        const std::string key = randomString(alphabet, length(generator));
+        if (seen.insert(CaseSensitive ? key : lower(key)).second)
+        {
+            keys.push_back(key);
+        }
+    }
+    return keys;
+}
+
+/**
+ * @brief checkAll Compares the trie with the naive scanner for every layout,
+ * engine and match kind on a set of texts.
+ */
+template <bool CaseSensitive>
+void checkAll(const std::vector<std::string> &keys, const std::vector<std::string> &texts)
+{
+    using T = Trie<CaseSensitive>;
+    const typename T::MatchKind kinds[] = {T::MatchKind::All, T::MatchKind::LeftmostFirst,
+                                           T::MatchKind::LeftmostLongest};
+    const typename T::Engine engines[] = {T::Engine::Automaton, T::Engine::Teddy};
+
+    for (const typename T::Engine engine : engines)
+    {
+        for (int layout = -1; layout <= 2; layout++)
+        {
+            T trie;
+            trie.addString(keys);
+            trie.setEngine(engine);
+            if (layout >= 0)
+            {
+                trie.freeze(static_cast<typename T::Layout>(layout));
+            }
+            for (const typename T::MatchKind kind : kinds)
+            {
+                trie.setMatchKind(kind);
+                for (const std::string &text : texts)
+                {
+                    if (trieMatches(trie, text) != naiveMatches<CaseSensitive>(keys, text, kind))
+                    {
+                        if (failures++ < 10)
+                        {
+                            std::printf("mismatch: case sensitive %d, engine %d, layout %d, kind %d, "
+                                        "%zu keywords, text \"%s\"\n",
+                                        CaseSensitive, static_cast<int>(engine), layout,
+                                        static_cast<int>(kind), keys.size(), text.c_str());
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @brief checkRandom Runs checkAll on random keyword sets. The texts mix runs
+ * of characters that start no keyword with keyword characters, so that the
+ * skip loops and the block loops of the SIMD engines see both.
+ */
+template <bool CaseSensitive>
+void checkRandom(const std::size_t rounds)
+{
+    const std::string keyAlphabet = CaseSensitive ? "abcd" : "abcdABCD";
+    std::uniform_int_distribution<std::size_t> keyCount(1, 80);
+    std::uniform_int_distribution<std::size_t> textLength(0, 300);
+    std::uniform_int_distribution<int> dense(0, 1);
+    for (std::size_t round = 0; round < rounds; round++)
+    {
+        const std::vector<std::string> keys = randomKeys<CaseSensitive>(keyAlphabet, keyCount(generator));
+        std::vector<std::string> texts;
+        for (int text = 0; text < 4; text++)
+        {
+            const std::string filler = dense(generator) ? "xyz" : "xyzxyzxyzxyzxyz";
+            texts.push_back(randomString(keyAlphabet + filler, textLength(generator)));
+        }
+        checkAll<CaseSensitive>(keys, texts);
+    }
+}
+
+/**
+ * @brief checkShared Replaces the trie of a shared_keyword_trie while reader
+ * threads keep searching. Every search must return the matches of one of the
+ * published keyword sets.
+ */
+void checkShared()
+{
+    constexpr std::size_t generations = 64;
+    const std::string text = randomString("abcdxyz", 2000);
+    std::vector<std::vector<std::string>> keySets;
+    std::vector<std::vector<Found>> expected;
+    for (std::size_t generation = 0; generation < generations; generation++)
+    {
+        keySets.push_back(randomKeys<true>("abcd", 20));
+        expected.push_back(naiveMatches<true>(keySets.back(), text, Trie<true>::MatchKind::All));
+    }
+
+    Trie<true> first;
+    first.addString(keySets[0]);
+    first.freeze();
+    miscco::shared_keyword_trie<> live(std::move(first));
+    std::atomic<bool> done{false};
+    std::atomic<std::size_t> stale{0};
+    std::vector<std::thread> readers;
+    for (int reader = 0; reader < 4; reader++)
+    {
+        readers.emplace_back([&] {
+            while (!done.load())
+            {
+                const std::vector<Found> found = trieMatches(*live.acquire(), text);
+                if (std::find(expected.begin(), expected.end(), found) == expected.end())
+                {
+                    stale++;
+                }
+            }
+        });
+    }
+    for (std::size_t generation = 1; generation < generations; generation++)
+    {
+        Trie<true> next;
+        next.addString(keySets[generation]);
+        next.freeze(static_cast<Trie<true>::Layout>(generation % 3));
+        live.replace(std::move(next));
+    }
+    done = true;
+    for (std::thread &reader : readers)
+    {
+        reader.join();
+    }
+    if (trieMatches(*live.acquire(), text) != expected.back() || stale != 0)
+    {
+        std::printf("mismatch: shared trie, %zu searches without a published keyword set\n",
+                    stale.load());
+        failures++;
+    }
+}
+} // namespace
+
+int main()
+{
+    checkRandom<true>(300);
+    checkRandom<false>(300);
+    checkShared();
+    if (failures != 0)
+    {
+        std::printf("%zu mismatches\n", failures);
+        return 1;
+    }
+    std::printf("all matches agree\n");
+    return 0;
+}